@@ -67,6 +67,8 @@ Settings="$Settings -Wno-unused-variable"
 Settings="$Settings -Wno-char-subscripts"
 Settings="$Settings -Wno-sign-compare"
 Settings="$Settings -fno-inline-functions"
+# NOTE: Keep a*b+c unfused, so the scalar and SIMD geometry tests in core.h round the same way on every target.
+Settings="$Settings -ffp-contract=off"
 # Settings="$Settings -fno-pie"
 # Settings="$Settings -E"
 
@@ -3,6 +3,7 @@
 
   TODO:
     [x] Implement BeginArena/EndArena functions instead of forcing the user to store arena-offsets in variables, which introduces too many un-needed names into their codebase.
+    [x] Growable arenas, which reserve a large range of virtual memory up front and commit pages as they are pushed. Pointers into the arena stay stable, since the arena never moves.
 */
 #ifndef __RYN_MEMORY__
 #define __RYN_MEMORY__
@@ -43,6 +44,7 @@
 #include <stdio.h> /* TODO: Create a way to disable or replace printf. */
 
 #include <stdint.h>
+#include <stddef.h>
 
 typedef struct
 {
@@ -50,13 +52,22 @@ typedef struct
     uint64_t Capacity;
     uint8_t *Data;
     uint64_t ParentOffset;
+    uint64_t Committed; /* NOTE: Bytes of Data that are backed by memory. Only less than Capacity for growable arenas. */
 } ryn_memory_(arena);
 
 void *ryn_memory_AllocateVirtualMemory(size_t Size);
 
+/* NOTE: Growable arenas commit memory in chunks of this size. */
+#ifndef ryn_memory_Commit_Size
+#define ryn_memory_Commit_Size (64*1024)
+#endif
+
 #ifdef Ryn_Memory_Types_Only
 ryn_memory_(arena) ryn_memory_(CreateArena)(uint64_t Size);
+ryn_memory_(arena) ryn_memory_(CreateGrowableArena)(uint64_t ReserveSize);
 void *ryn_memory_(PushSize)(ryn_memory_(arena) *Arena, uint64_t Size);
+void ryn_memory_(AlignArena)(ryn_memory_(arena) *Arena, uint64_t Alignment);
+void *ryn_memory_(PushAlignedSize)(ryn_memory_(arena) *Arena, uint64_t Size, uint64_t Alignment);
 uint64_t ryn_memory_(GetArenaFreeSpace)(ryn_memory_(arena) *Arena);
 ryn_memory_(arena) ryn_memory_(CreateSubArena)(ryn_memory_(arena) *Arena, uint64_t Size);
 uint32_t ryn_memory_(IsArenaUsable)(ryn_memory_(arena) Arena);
@@ -65,6 +76,7 @@ uint8_t *ryn_memory_(GetArenaWriteLocation)(ryn_memory_(arena) *Arena);
 uint32_t ryn_memory_(FreeArena)(ryn_memory_(arena) Arena);
 void *ryn_memory_(PushZeroArena)(ryn_memory_(arena) *Arena, uint64_t Size);
 uint64_t ryn_memory_(PushChar)(ryn_memory_(arena) *Arena, uint8_t Char);
+void ryn_memory_(CopyMemory)(uint8_t *Source, uint8_t *Destination, uint64_t Size);
 #endif /* Ryn_Memory_Types_Only */
 
 
@@ -94,6 +106,15 @@ uint64_t ryn_memory_(PushChar)(ryn_memory_(arena) *Arena, uint8_t Char);
 #define ryn_memory_PushZeroArray(arena, type, count) \
     (type *)(ryn_memory_(PushZeroArena)((arena), (count)*sizeof(type)))
 
+/* NOTE: The plain pushes above don't pad, so arrays of one type can be pushed back to back and indexed as one array. Arenas that mix types, like strings and arrays, use the aligned pushes below for anything wider than a byte. */
+#define ryn_memory_AlignOf(type) offsetof(struct { char C; type T; }, T)
+
+#define ryn_memory_PushAlignedStruct(arena, type) \
+    (type *)(ryn_memory_(PushAlignedSize)((arena), sizeof(type), ryn_memory_AlignOf(type)))
+
+#define ryn_memory_PushAlignedArray(arena, type, count) \
+    (type *)(ryn_memory_(PushAlignedSize)((arena), (count)*sizeof(type), ryn_memory_AlignOf(type)))
+
 #define ryn_memory_BeginArena(arena) uint64_t ryn_memory_##arena##_OldOffset = (arena)->Offset
 #define ryn_memory_EndArena(arena) (arena)->Offset = ryn_memory_##arena##_OldOffset
 
@@ -170,12 +191,50 @@ void *ryn_memory_(AllocateVirtualMemory)(size_t Size)
         return Result;
     }
 }
+/* NOTE: Reserves address space without backing it by memory, so reserving a huge range is cheap. */
+void *ryn_memory_(ReserveVirtualMemory)(size_t Size)
+{
+    uint8_t *Result = mmap(0, Size, PROT_NONE, MAP_ANON | MAP_PRIVATE, -1, 0);
+
+    if (Result == MAP_FAILED)
+    {
+        printf("Error in ReserveVirtualMemory: failed to reserve memory with errno = %d\n", errno);
+        Result = 0;
+    }
+
+    return Result;
+}
+
+uint32_t ryn_memory_(CommitVirtualMemory)(void *Address, size_t Size)
+{
+    uint32_t Error = 0;
+
+    if (mprotect(Address, Size, PROT_READ | PROT_WRITE) != 0)
+    {
+        printf("Error in CommitVirtualMemory: failed to commit memory with errno = %d\n", errno);
+        Error = 1;
+    }
+
+    return Error;
+}
 #elif ryn_memory_Windows
 void *ryn_memory_(AllocateVirtualMemory)(size_t Size)
 {
-    void *Result = VirtualAlloc(0, Size, MEM_RESERVE, PAGE_READWRITE);
+    void *Result = VirtualAlloc(0, Size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    return Result;
+}
+
+void *ryn_memory_(ReserveVirtualMemory)(size_t Size)
+{
+    void *Result = VirtualAlloc(0, Size, MEM_RESERVE, PAGE_NOACCESS);
     return Result;
 }
+
+uint32_t ryn_memory_(CommitVirtualMemory)(void *Address, size_t Size)
+{
+    uint32_t Error = VirtualAlloc(Address, Size, MEM_COMMIT, PAGE_READWRITE) == 0;
+    return Error;
+}
 #endif
 
 ryn_memory_(arena) ryn_memory_(CreateArena)(uint64_t Size)
@@ -186,16 +245,60 @@ ryn_memory_(arena) ryn_memory_(CreateArena)(uint64_t Size)
     Arena.Capacity = Size;
     Arena.Data = ryn_memory_(AllocateVirtualMemory)(Size);
     Arena.ParentOffset = 0;
+    Arena.Committed = Arena.Data ? Size : 0;
+
+    return Arena;
+}
+
+/*
+  A growable arena reserves ReserveSize bytes of address space, but only commits memory as it gets pushed onto. The arena never moves, so pointers into it stay valid as it grows, and nothing is ever copied.
+*/
+ryn_memory_(arena) ryn_memory_(CreateGrowableArena)(uint64_t ReserveSize)
+{
+    ryn_memory_(arena) Arena;
+
+    Arena.Offset = 0;
+    Arena.Capacity = ReserveSize;
+    Arena.Data = ryn_memory_(ReserveVirtualMemory)(ReserveSize);
+    Arena.ParentOffset = 0;
+    Arena.Committed = 0;
 
     return Arena;
 }
 
+/* NOTE: Makes sure the first NewOffset bytes of the arena are committed. Returns 0 if the arena can't hold that many bytes. */
+uint32_t ryn_memory_(EnsureArenaCommitted)(ryn_memory_(arena) *Arena, uint64_t NewOffset)
+{
+    uint32_t Ok = NewOffset <= Arena->Capacity;
+
+    if (Ok && NewOffset > Arena->Committed)
+    {
+        uint64_t NewCommitted = (NewOffset + ryn_memory_Commit_Size - 1) & ~((uint64_t)ryn_memory_Commit_Size - 1);
+        if (NewCommitted > Arena->Capacity)
+        {
+            NewCommitted = Arena->Capacity;
+        }
+
+        uint32_t Error = ryn_memory_(CommitVirtualMemory)(Arena->Data + Arena->Committed, NewCommitted - Arena->Committed);
+        if (Error)
+        {
+            Ok = 0;
+        }
+        else
+        {
+            Arena->Committed = NewCommitted;
+        }
+    }
+
+    return Ok;
+}
+
 
 void *ryn_memory_(PushSize)(ryn_memory_(arena) *Arena, uint64_t Size)
 {
     uint8_t *Result = 0;
 
-    if (Arena && (Size + Arena->Offset) < Arena->Capacity)
+    if (Arena && Arena->Data && ryn_memory_(EnsureArenaCommitted)(Arena, Arena->Offset + Size))
     {
         Result = &Arena->Data[Arena->Offset];
         Arena->Offset += Size;
@@ -205,14 +308,39 @@ void *ryn_memory_(PushSize)(ryn_memory_(arena) *Arena, uint64_t Size)
 }
 
 
-void *ryn_memory_(PushZeroArena)(ryn_memory_(arena) *Arena, uint64_t Size)
+/* NOTE: Pads the offset so the next push starts at an address that is a multiple of Alignment, which has to be a power of two. The padding isn't committed until something is pushed after it. */
+void ryn_memory_(AlignArena)(ryn_memory_(arena) *Arena, uint64_t Alignment)
+{
+    uint64_t Padding = (uint64_t)(-(uintptr_t)(Arena->Data + Arena->Offset)) & (Alignment - 1);
+    uint64_t AlignedOffset = Arena->Offset + Padding;
+
+    if (AlignedOffset <= Arena->Capacity)
+    {
+        Arena->Offset = AlignedOffset;
+    }
+}
+
+
+void *ryn_memory_(PushAlignedSize)(ryn_memory_(arena) *Arena, uint64_t Size, uint64_t Alignment)
 {
     uint8_t *Result = 0;
 
-    if (Arena && (Size + Arena->Offset) < Arena->Capacity)
+    if (Arena)
+    {
+        ryn_memory_(AlignArena)(Arena, Alignment);
+        Result = ryn_memory_(PushSize)(Arena, Size);
+    }
+
+    return Result;
+}
+
+
+void *ryn_memory_(PushZeroArena)(ryn_memory_(arena) *Arena, uint64_t Size)
+{
+    uint8_t *Result = ryn_memory_(PushSize)(Arena, Size);
+
+    if (Result)
     {
-        Result = &Arena->Data[Arena->Offset];
-        Arena->Offset += Size;
         memset(Result, 0, Size);
     }
 
@@ -297,8 +425,8 @@ ryn_memory_(arena) ryn_memory_(CreateSubArena)(ryn_memory_(arena) *Arena, uint64
     if (Size <= ryn_memory_(GetArenaFreeSpace)(Arena))
     {
         SubArena.Capacity = Size;
-        SubArena.Data = ryn_memory_(GetArenaWriteLocation)(Arena);
-        ryn_memory_(PushSize)(Arena, Size);
+        SubArena.Committed = Size;
+        SubArena.Data = ryn_memory_(PushSize)(Arena, Size);
     }
 
     return SubArena;
@@ -4,7 +4,7 @@
 
 #define function static
 #define global_variable static
-#define Kilobytes(n) (1024 * (n))
+#define Kilobytes(n) ((U64)1024 * (n))
 #define Megabytes(n) (1024 * Kilobytes(n))
 #define Gigabytes(n) (1024 * Megabytes(n))
 
@@ -71,14 +71,150 @@ function F32 which_side_of_line(Vector2 a, Vector2 b, Vector2 p) {
 
 
 
+////////////////
+//  Robust orientation
+////////////////
+/*
+  which_side_of_line rounds, so for points on or very close to a line its sign is noise. That makes points on an edge shared by two triangles land in neither of them, and makes tests against thin triangles flicker.
+
+  orient_2d gives the same sign as which_side_of_line would with exact arithmetic. It is Shewchuk's filtered predicate (https://www.cs.cmu.edu/~quake/robust.html): a float determinant is trusted when it is further from zero than its worst-case rounding error, and only otherwise is the determinant summed exactly.
+*/
+
+// NOTE: (3 + 16e)e for e = 2^-24, the float epsilon in Shewchuk's terms, rounded up to 4e.
+#define Orient_2D_Error_Bound (4.0f * 5.9604645e-08f)
+
+// NOTE: x + y == a + b exactly, with x the rounded sum and y its rounding error.
+#define Two_Sum(a, b, x, y) do {\
+    (x) = (a) + (b);\
+    F64 b_virtual_ = (x) - (a);\
+    F64 a_virtual_ = (x) - b_virtual_;\
+    (y) = ((a) - a_virtual_) + ((b) - b_virtual_);\
+  } while (0)
+
+
+/*
+  The exact sign of the determinant, as -1, 0 or 1. Products of two floats are exact in doubles, so the six terms are exact, and they are summed without rounding into an expansion whose largest non-zero component has the sign of the total.
+*/
+function F32 orient_2d_exact(Vector2 a, Vector2 b, Vector2 p) {
+  F64 terms[6] = {
+    (F64)a.x*(F64)b.y, (F64)a.y*(F64)p.x, (F64)b.x*(F64)p.y,
+    -(F64)b.y*(F64)p.x, -(F64)a.y*(F64)b.x, -(F64)a.x*(F64)p.y,
+  };
+  F64 expansion[6];
+  S32 expansion_count = 0;
+
+  for (S32 i = 0; i < 6; ++i) {
+    F64 q = terms[i];
+    for (S32 j = 0; j < expansion_count; ++j) {
+      F64 sum, error;
+      Two_Sum(q, expansion[j], sum, error);
+      expansion[j] = error;
+      q = sum;
+    }
+    expansion[expansion_count++] = q;
+  }
+
+  F32 sign = 0.0f;
+  for (S32 i = expansion_count-1; i >= 0 && sign == 0.0f; --i) {
+    sign = expansion[i] > 0.0 ? 1.0f : (expansion[i] < 0.0 ? -1.0f : 0.0f);
+  }
+
+  return sign;
+}
+
+
+/*
+  Which side of the line a-b the point p is on, with the same sign as which_side_of_line but always correct. Only the sign is meaningful: when the float result is too close to call, -1, 0 or 1 is returned.
+*/
+function F32 orient_2d(Vector2 a, Vector2 b, Vector2 p) {
+  F32 left = (a.x - p.x) * (b.y - p.y);
+  F32 right = (a.y - p.y) * (b.x - p.x);
+  F32 side = left - right;
+  F32 error_bound = Orient_2D_Error_Bound * (fabsf(left) + fabsf(right));
+
+  // NOTE: This is the only branch on the fast path, and it is almost never taken, so it predicts well.
+  if (fabsf(side) <= error_bound) {
+    side = orient_2d_exact(a, b, p);
+  }
+
+  return side;
+}
+
+
+/*
+  Which of the two triangles that share the edge a-b owns the points exactly on it. Neighbouring triangles with the same winding walk a shared edge in opposite directions, so exactly one of them owns it.
+*/
+function B32 edge_owns_boundary(Vector2 a, Vector2 b) {
+  B32 owns = b.y < a.y || (b.y == a.y && b.x > a.x);
+  return owns;
+}
+
+
+function B32 is_inside_edge(Vector2 a, Vector2 b, Vector2 p) {
+  F32 side = orient_2d(a, b, p);
+  B32 inside = side < 0.0f || (side == 0.0f && edge_owns_boundary(a, b));
+  return inside;
+}
+
+
+// NOTE: The float filter of orient_2d for one edge, folded into the certainty of a whole triangle. Bitwise, so the edges don't branch on each other.
+#define Orient_2D_Filter(from, to, p, certain_inside, certain_outside) do {\
+    F32 left_ = ((from).x - (p).x) * ((to).y - (p).y);\
+    F32 right_ = ((from).y - (p).y) * ((to).x - (p).x);\
+    F32 side_ = left_ - right_;\
+    F32 error_bound_ = Orient_2D_Error_Bound * (fabsf(left_) + fabsf(right_));\
+    (certain_inside) &= side_ < -error_bound_;\
+    (certain_outside) |= side_ > error_bound_;\
+  } while (0)
+
+
+/*
+  True if p is inside the triangle a-b-c, which winds so its inside is on the negative side of every edge. Points on edges go to the triangle that owns the edge, and degenerate triangles contain nothing.
+*/
+function B32 triangle_contains_point(Vector2 a, Vector2 b, Vector2 c, Vector2 p) {
+  // NOTE: Nearly every test is decided by the float filter, so run it on the edges before making any calls. Most points are far outside, which the first edge usually settles.
+  B32 certain_inside = 1;
+  B32 certain_outside = 0;
+  Orient_2D_Filter(a, b, p, certain_inside, certain_outside);
+  if (!certain_outside) {
+    Orient_2D_Filter(b, c, p, certain_inside, certain_outside);
+    Orient_2D_Filter(c, a, p, certain_inside, certain_outside);
+  }
+
+  B32 contains = certain_inside;
+  if (!certain_inside && !certain_outside) {
+    contains = is_inside_edge(a, b, p) && is_inside_edge(b, c, p) && is_inside_edge(c, a, p);
+  }
+
+  return contains;
+}
+
+
+
+
 /*
   Figure out which "side" of a cubic bezier-line "p" is at. The implicit form of the bezier curve is taken from: https://www.mare.ee/indrek/misc/2d.pdf
 
   I'm out of my depth here, but we basically need to get an implicit form of the bezier curve so that we can plug in an x and y and get back a scalar. Positive is one side of the curve, and negative is the other.
 
   After testing this, you DO get good information about which side if you are close, but you also get some STRANGE results if you are far away from the curve. Basically, the curve is extended beyond the control points, so you will still need to do some other checks to use this functions effectively. Good luck!
+
+  The coefficients only depend on the control points, so get_implicit_bezier computes them once per curve where side tests are needed, and evaluate_implicit_bezier plugs in each test point.
 */
-function F32 which_side_of_bezier(Vector2 first_point, Vector2 second_point, Vector2 first_control, Vector2 second_control, Vector2 test_point) {
+typedef struct {
+  F32 v_xxx;
+  F32 v_xxy;
+  F32 v_xyy;
+  F32 v_yyy;
+  F32 v_xx;
+  F32 v_xy;
+  F32 v_yy;
+  F32 v_x;
+  F32 v_y;
+  F32 v_0;
+} Implicit_Bezier;
+
+function Implicit_Bezier get_implicit_bezier(Vector2 first_point, Vector2 second_point, Vector2 first_control, Vector2 second_control) {
   // NOTE: The source text defined p0-p3 with control points as p1 and p2. Renaming to make copy-paste easier.
   Vector2 p0 = first_point;
   Vector2 p1 = first_control;
@@ -134,6 +270,13 @@ function F32 which_side_of_bezier(Vector2 first_point, Vector2 second_point, Vec
     + 2.0f* a0 *b0 *b2*b3 * a2 * a2 + 3.0f* a0 *b0 *b1 *b2 * a3 * a3
     + 3.0f* a1 * a2 * a3 *b3 *b0*b0 + a3 * a3 * a3 *b0 *b0*b0 - a0 * a0 * a0 *b3 *b3 *b3
     + a3 * a0 * a0 *b2*b2 *b2 - a0 * a3 * a3 *b1*b1 *b1;
+
+  Implicit_Bezier implicit = (Implicit_Bezier){v_xxx, v_xxy, v_xyy, v_yyy, v_xx, v_xy, v_yy, v_x, v_y, v_0};
+  return implicit;
+}
+
+
+function F32 evaluate_implicit_bezier(Implicit_Bezier *b, Vector2 test_point) {
   // NOTE: Really should study up on this stuff and give better annotations...
   F32 x = test_point.x;
   F32 y = test_point.y;
@@ -143,8 +286,15 @@ function F32 which_side_of_bezier(Vector2 first_point, Vector2 second_point, Vec
   F32 yyy = y*y*y;
 
   // NOTE: Have faith
-  F32 side = v_xxx*xxx + v_xxy*xx*y + v_xyy*x*yy + v_yyy*yyy + v_xx*xx + v_xy*x*y + v_yy*yy + v_x*x + v_y*y + v_0;
+  F32 side = b->v_xxx*xxx + b->v_xxy*xx*y + b->v_xyy*x*yy + b->v_yyy*yyy + b->v_xx*xx + b->v_xy*x*y + b->v_yy*yy + b->v_x*x + b->v_y*y + b->v_0;
+
+  return side;
+}
+
 
+function F32 which_side_of_bezier(Vector2 first_point, Vector2 second_point, Vector2 first_control, Vector2 second_control, Vector2 test_point) {
+  Implicit_Bezier implicit = get_implicit_bezier(first_point, second_point, first_control, second_control);
+  F32 side = evaluate_implicit_bezier(&implicit, test_point);
   return side;
 }
 
@@ -168,6 +318,71 @@ function Vector2 get_bezier_point(Vector2 first_point, Vector2 second_point, Vec
 
 
 
+/*
+  The Bernstein basis of a cubic bezier: row i holds the weights of first_point, first_control, second_control and second_point at t = i/segment_count.
+
+  Half-circle fans are tessellated at a fixed resolution (12 triangles, so 13 segments), so its table is built by the compiler from the X-list below, and a point costs eight multiply-adds. Other resolutions, like the adaptive ones of wires, work out their weights as they go.
+*/
+#define Bezier_Basis_13_Xlist\
+  X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13)
+
+#define Bezier_Basis_T(i, n) ((F32)(i) / (F32)(n))
+#define Bezier_Basis_Weights(i, n) {\
+    (1.0f - Bezier_Basis_T(i, n)) * (1.0f - Bezier_Basis_T(i, n)) * (1.0f - Bezier_Basis_T(i, n)),\
+    3.0f * (1.0f - Bezier_Basis_T(i, n)) * (1.0f - Bezier_Basis_T(i, n)) * Bezier_Basis_T(i, n),\
+    3.0f * (1.0f - Bezier_Basis_T(i, n)) * Bezier_Basis_T(i, n) * Bezier_Basis_T(i, n),\
+    Bezier_Basis_T(i, n) * Bezier_Basis_T(i, n) * Bezier_Basis_T(i, n),\
+  }
+
+typedef F32 Bezier_Basis_Row[4];
+
+global_variable Bezier_Basis_Row bezier_basis_13[] = {
+#define X(i)\
+  Bezier_Basis_Weights(i, 13),
+  Bezier_Basis_13_Xlist
+#undef X
+};
+
+
+/*
+  The precomputed basis for segment_count, or zero if there isn't one.
+*/
+function Bezier_Basis_Row *get_bezier_basis(S32 segment_count) {
+  Bezier_Basis_Row *basis = 0;
+
+  if (segment_count == 13) {
+    basis = bezier_basis_13;
+  }
+
+  return basis;
+}
+
+
+/*
+  Write the segment_count+1 points at t = i/segment_count, both ends included. The ends come out exactly as first_point and second_point, since their weights are exactly one and zero.
+*/
+function void get_bezier_points(Vector2 first_point, Vector2 second_point, Vector2 first_control, Vector2 second_control, S32 segment_count, Vector2 *points) {
+  Bezier_Basis_Row *basis = get_bezier_basis(segment_count);
+
+  if (basis) {
+    for (S32 i = 0; i <= segment_count; ++i) {
+      F32 *w = basis[i];
+      points[i].x = w[0]*first_point.x + w[1]*first_control.x + w[2]*second_control.x + w[3]*second_point.x;
+      points[i].y = w[0]*first_point.y + w[1]*first_control.y + w[2]*second_control.y + w[3]*second_point.y;
+    }
+  } else {
+    for (S32 i = 0; i <= segment_count; ++i) {
+      F32 t = (F32)i / (F32)segment_count;
+      F32 it = 1.0f - t;
+      F32 w[4] = {it*it*it, 3.0f*it*it*t, 3.0f*it*t*t, t*t*t};
+      points[i].x = w[0]*first_point.x + w[1]*first_control.x + w[2]*second_control.x + w[3]*second_point.x;
+      points[i].y = w[0]*first_point.y + w[1]*first_control.y + w[2]*second_control.y + w[3]*second_point.y;
+    }
+  }
+}
+
+
+
 /*
   This assumes that the bezier is convex, otherwise the triangles might get wonky.
 */
@@ -177,15 +392,336 @@ function S32 create_bezier_triangle_fan(Vector2 first_point, Vector2 second_poin
 
   if (needed_point_count <= max_points) {
     point_count = needed_point_count;
-    points[point_count-1] = first_point;
-    points[0] = second_point;
-    for (S32 i = 1; i < point_count-1; ++i) {
-      F32 amount = (point_count-1) - i;
-      F32 t = (F32)amount / (F32)(point_count-1);
-      Vector2 p = get_bezier_point(first_point, second_point, first_control, second_control, t);
-      points[i] = p;
-    }
+    // NOTE: The fan walks the curve from second_point back to first_point, which is the same curve with its ends and controls swapped.
+    get_bezier_points(second_point, first_point, second_control, first_control, point_count-1, points);
   }
 
   return point_count;
 }
+
+
+
+
+////////////////
+//  Stroking
+////////////////
+#define Stroke_Miter_Limit 4.0f
+
+// NOTE: A beveled corner takes two pairs of points, and one more pair closes the strip.
+#define Stroke_Max_Strip_Count(point_count) (4*(point_count) + 2)
+
+/*
+  The unit normal on the left of the edge from a to b, the same side DrawLineEx offsets its strip to. Zero if a and b are the same point.
+*/
+function Vector2 get_edge_normal(Vector2 a, Vector2 b) {
+  Vector2 normal = {0};
+  F32 dx = b.x - a.x;
+  F32 dy = b.y - a.y;
+  F32 length = sqrtf(dx*dx + dy*dy);
+
+  if (length > 0.0f) {
+    normal = (Vector2){-dy/length, dx/length};
+  }
+
+  return normal;
+}
+
+/*
+  Stroke a closed polygon with a single triangle strip, thickness wide and centered on its edges. Corners get miter joins, unless the miter would reach further than Stroke_Miter_Limit half-thicknesses, and then they get a bevel.
+
+  The strip alternates between the right and the left side of the outline, the same way DrawLineEx builds its strip, so it faces the same way whichever way the polygon winds. strip needs room for Stroke_Max_Strip_Count(point_count) points, and the number of points written is returned.
+*/
+function S32 get_polygon_stroke(Vector2 *points, S32 point_count, F32 thickness, Vector2 *strip) {
+  S32 strip_count = 0;
+  F32 half = 0.5f*thickness;
+
+  for (S32 i = 0; i < point_count; ++i) {
+    Vector2 p = points[i];
+    Vector2 previous = points[(i + point_count - 1) % point_count];
+
+    // NOTE: A zero-length edge has no normal, and would make the corner twice as wide. So a run of coincident points gets a single corner, at its first point, between the nearest distinct points on either side.
+    if (p.x != previous.x || p.y != previous.y) {
+      S32 next = (i + 1) % point_count;
+      while (points[next].x == p.x && points[next].y == p.y) {
+        next = (next + 1) % point_count;
+      }
+
+      Vector2 n0 = get_edge_normal(previous, p);
+      Vector2 n1 = get_edge_normal(p, points[next]);
+      Vector2 m = (Vector2){n0.x + n1.x, n0.y + n1.y};
+      F32 m_length = sqrtf(m.x*m.x + m.y*m.y);
+
+      // NOTE: The miter runs along m, and reaches half/cos_half from the corner, where cos_half is the cosine of half the angle between the normals.
+      F32 cos_half = 0.5f*m_length;
+      F32 miter_length = (cos_half*Stroke_Miter_Limit > 1.0f) ? half/cos_half : Stroke_Miter_Limit*half;
+      F32 miter_scale = (m_length > 0.0f) ? miter_length/m_length : 0.0f;
+      Vector2 miter = (Vector2){miter_scale*m.x, miter_scale*m.y};
+
+      if (cos_half*Stroke_Miter_Limit > 1.0f) {
+        strip[strip_count++] = (Vector2){p.x - miter.x, p.y - miter.y};
+        strip[strip_count++] = (Vector2){p.x + miter.x, p.y + miter.y};
+      } else {
+        // NOTE: The bevel cuts across the outer side of the corner, and the inner side keeps the miter, clamped to the limit.
+        F32 turn = n0.x*n1.y - n0.y*n1.x;
+        if (turn > 0.0f) {
+          Vector2 inner = (Vector2){p.x + miter.x, p.y + miter.y};
+          strip[strip_count++] = (Vector2){p.x - half*n0.x, p.y - half*n0.y};
+          strip[strip_count++] = inner;
+          strip[strip_count++] = (Vector2){p.x - half*n1.x, p.y - half*n1.y};
+          strip[strip_count++] = inner;
+        } else {
+          Vector2 inner = (Vector2){p.x - miter.x, p.y - miter.y};
+          strip[strip_count++] = inner;
+          strip[strip_count++] = (Vector2){p.x + half*n0.x, p.y + half*n0.y};
+          strip[strip_count++] = inner;
+          strip[strip_count++] = (Vector2){p.x + half*n1.x, p.y + half*n1.y};
+        }
+      }
+    }
+  }
+
+  // NOTE: The first pair of points always lies on the edge coming into the first corner, so repeating it closes the outline.
+  if (strip_count) {
+    strip[strip_count] = strip[0];
+    strip[strip_count+1] = strip[1];
+    strip_count += 2;
+  }
+
+  return strip_count;
+}
+
+
+
+
+////////////////
+//  Batched point-in-triangle tests
+////////////////
+/*
+  Four lanes at a time with SSE2 on x64 and NEON on arm64, and one at a time everywhere else. The lanes run the float filter of orient_2d, and any lane the filter can't decide is redone with the scalar triangle_contains_point, so batched and one-at-a-time tests always agree.
+*/
+#if ARCH_X64
+# include <emmintrin.h>
+# define Lane_Width 4
+typedef __m128 F32x4;
+# define F32x4_Set1(a)        _mm_set1_ps(a)
+# define F32x4_Load(p)        _mm_loadu_ps(p)
+# define F32x4_Store(p, a)    _mm_storeu_ps((p), (a))
+# define F32x4_Add(a, b)      _mm_add_ps((a), (b))
+# define F32x4_Sub(a, b)      _mm_sub_ps((a), (b))
+# define F32x4_Mul(a, b)      _mm_mul_ps((a), (b))
+# define F32x4_Less_Than(a, b) _mm_cmplt_ps((a), (b))
+# define F32x4_Abs(a)         _mm_andnot_ps(_mm_set1_ps(-0.0f), (a))
+# define F32x4_Negate(a)      _mm_xor_ps(_mm_set1_ps(-0.0f), (a))
+# define F32x4_And(a, b)      _mm_and_ps((a), (b))
+# define F32x4_Or(a, b)       _mm_or_ps((a), (b))
+# define F32x4_Zero_Mask()    _mm_setzero_ps()
+# define F32x4_Mask_Bits(m)   ((U32)_mm_movemask_ps(m))
+// NOTE: Split four interleaved Vector2s into their xs and ys.
+# define F32x4_Load_Vector2s(points, xs, ys) do {\
+    __m128 lo_ = _mm_loadu_ps((F32 *)(points));\
+    __m128 hi_ = _mm_loadu_ps((F32 *)(points) + 4);\
+    (xs) = _mm_shuffle_ps(lo_, hi_, _MM_SHUFFLE(2, 0, 2, 0));\
+    (ys) = _mm_shuffle_ps(lo_, hi_, _MM_SHUFFLE(3, 1, 3, 1));\
+  } while (0)
+typedef __m128 Mask32x4;
+#elif ARCH_ARM64
+# include <arm_neon.h>
+# define Lane_Width 4
+typedef float32x4_t F32x4;
+# define F32x4_Set1(a)        vdupq_n_f32(a)
+# define F32x4_Load(p)        vld1q_f32(p)
+# define F32x4_Store(p, a)    vst1q_f32((p), (a))
+# define F32x4_Add(a, b)      vaddq_f32((a), (b))
+# define F32x4_Sub(a, b)      vsubq_f32((a), (b))
+# define F32x4_Mul(a, b)      vmulq_f32((a), (b))
+# define F32x4_Less_Than(a, b) vcltq_f32((a), (b))
+# define F32x4_Abs(a)         vabsq_f32(a)
+# define F32x4_Negate(a)      vnegq_f32(a)
+# define F32x4_And(a, b)      vandq_u32((a), (b))
+# define F32x4_Or(a, b)       vorrq_u32((a), (b))
+# define F32x4_Zero_Mask()    vdupq_n_u32(0)
+# define F32x4_Mask_Bits(m)   vaddvq_u32(vandq_u32((m), (uint32x4_t){1, 2, 4, 8}))
+# define F32x4_Load_Vector2s(points, xs, ys) do {\
+    float32x4x2_t xy_ = vld2q_f32((F32 *)(points));\
+    (xs) = xy_.val[0];\
+    (ys) = xy_.val[1];\
+  } while (0)
+typedef uint32x4_t Mask32x4;
+#else
+# define Lane_Width 1
+#endif
+
+
+#if Lane_Width == 4
+/*
+  The float filter of orient_2d in four lanes: the lanes where the point is certainly inside the edge a-b, and where it is certainly outside. Lanes in neither mask need the exact test.
+*/
+function void orient_2d_x4(F32x4 ax, F32x4 ay, F32x4 bx, F32x4 by, F32x4 px, F32x4 py, Mask32x4 *certain_inside, Mask32x4 *certain_outside) {
+  F32x4 left = F32x4_Mul(F32x4_Sub(ax, px), F32x4_Sub(by, py));
+  F32x4 right = F32x4_Mul(F32x4_Sub(ay, py), F32x4_Sub(bx, px));
+  F32x4 side = F32x4_Sub(left, right);
+  F32x4 error_bound = F32x4_Mul(F32x4_Set1(Orient_2D_Error_Bound), F32x4_Add(F32x4_Abs(left), F32x4_Abs(right)));
+
+  *certain_inside = F32x4_Less_Than(side, F32x4_Negate(error_bound));
+  *certain_outside = F32x4_Less_Than(error_bound, side);
+}
+#endif
+
+
+/*
+  The batched version of a triangle_fan_contains_point loop: results[i] is set when points[i] is inside any triangle of the fan.
+*/
+function void triangle_fan_contains_points(Vector2 *fan, S32 triangle_count, Vector2 *points, S32 point_count, B32 *results) {
+  S32 i = 0;
+
+#if Lane_Width == 4
+  for (; i + 4 <= point_count; i += 4) {
+    F32x4 px, py;
+    F32x4_Load_Vector2s(points + i, px, py);
+    Mask32x4 contains = F32x4_Zero_Mask();
+    U32 decided_bits = 0;
+    U32 undecided_bits = 0;
+
+    for (S32 t = 1; t <= triangle_count; ++t) {
+      Vector2 v[3] = {fan[0], fan[t], fan[t+1]};
+      Mask32x4 inside = F32x4_Zero_Mask();
+      Mask32x4 outside = F32x4_Zero_Mask();
+
+      for (S32 e = 0; e < 3; ++e) {
+        Vector2 a = v[e];
+        Vector2 b = v[(e+1) % 3];
+        Mask32x4 edge_inside, edge_outside;
+        orient_2d_x4(F32x4_Set1(a.x), F32x4_Set1(a.y), F32x4_Set1(b.x), F32x4_Set1(b.y), px, py, &edge_inside, &edge_outside);
+        inside = e == 0 ? edge_inside : F32x4_And(inside, edge_inside);
+        outside = F32x4_Or(outside, edge_outside);
+      }
+
+      contains = F32x4_Or(contains, inside);
+      undecided_bits |= ~(F32x4_Mask_Bits(inside) | F32x4_Mask_Bits(outside)) & 0xf;
+    }
+
+    decided_bits = F32x4_Mask_Bits(contains);
+    for (S32 k = 0; k < 4; ++k) {
+      if ((decided_bits >> k) & 1) {
+        results[i+k] = 1;
+      } else if ((undecided_bits >> k) & 1) {
+        results[i+k] = 0;
+        for (S32 t = 1; t <= triangle_count && !results[i+k]; ++t) {
+          results[i+k] = triangle_contains_point(fan[0], fan[t], fan[t+1], points[i+k]);
+        }
+      } else {
+        results[i+k] = 0;
+      }
+    }
+  }
+#endif
+
+  for (; i < point_count; ++i) {
+    results[i] = 0;
+    for (S32 t = 1; t <= triangle_count && !results[i]; ++t) {
+      results[i] = triangle_contains_point(fan[0], fan[t], fan[t+1], points[i]);
+    }
+  }
+}
+
+
+/*
+  Triangles in structure-of-arrays form, for testing one point against many triangles. Every triangle winds like the ones triangle_contains_point takes.
+*/
+typedef struct {
+  F32 *ax;
+  F32 *ay;
+  F32 *bx;
+  F32 *by;
+  F32 *cx;
+  F32 *cy;
+  S32 count;
+} Triangle_Batch;
+
+
+/*
+  results[i] is set when triangle i contains point.
+*/
+function void triangle_batch_contains_point(Triangle_Batch *batch, Vector2 point, B32 *results) {
+  S32 i = 0;
+
+#if Lane_Width == 4
+  F32x4 px = F32x4_Set1(point.x);
+  F32x4 py = F32x4_Set1(point.y);
+
+  for (; i + 4 <= batch->count; i += 4) {
+    F32x4 ax = F32x4_Load(batch->ax + i);
+    F32x4 ay = F32x4_Load(batch->ay + i);
+    F32x4 bx = F32x4_Load(batch->bx + i);
+    F32x4 by = F32x4_Load(batch->by + i);
+    F32x4 cx = F32x4_Load(batch->cx + i);
+    F32x4 cy = F32x4_Load(batch->cy + i);
+
+    Mask32x4 inside_ab, outside_ab, inside_bc, outside_bc, inside_ca, outside_ca;
+    orient_2d_x4(ax, ay, bx, by, px, py, &inside_ab, &outside_ab);
+    orient_2d_x4(bx, by, cx, cy, px, py, &inside_bc, &outside_bc);
+    orient_2d_x4(cx, cy, ax, ay, px, py, &inside_ca, &outside_ca);
+
+    U32 inside_bits = F32x4_Mask_Bits(F32x4_And(inside_ab, F32x4_And(inside_bc, inside_ca)));
+    U32 outside_bits = F32x4_Mask_Bits(F32x4_Or(outside_ab, F32x4_Or(outside_bc, outside_ca)));
+
+    for (S32 k = 0; k < 4; ++k) {
+      results[i+k] = (inside_bits >> k) & 1;
+    }
+
+    U32 undecided_bits = ~(inside_bits | outside_bits) & 0xf;
+    while (undecided_bits) {
+      S32 k = 0;
+      while (!((undecided_bits >> k) & 1)) {
+        k += 1;
+      }
+      undecided_bits &= ~(1u << k);
+
+      S32 t = i + k;
+      results[t] = triangle_contains_point((Vector2){batch->ax[t], batch->ay[t]}, (Vector2){batch->bx[t], batch->by[t]}, (Vector2){batch->cx[t], batch->cy[t]}, point);
+    }
+  }
+#endif
+
+  for (; i < batch->count; ++i) {
+    Vector2 a = (Vector2){batch->ax[i], batch->ay[i]};
+    Vector2 b = (Vector2){batch->bx[i], batch->by[i]};
+    Vector2 c = (Vector2){batch->cx[i], batch->cy[i]};
+    results[i] = triangle_contains_point(a, b, c, point);
+  }
+}
+
+
+/*
+  The batched version of evaluate_implicit_bezier: sides[i] is the side of points[i]. The lanes evaluate the polynomial term by term in the same order as the scalar version.
+*/
+function void evaluate_implicit_bezier_points(Implicit_Bezier *b, Vector2 *points, S32 point_count, F32 *sides) {
+  S32 i = 0;
+
+#if Lane_Width == 4
+  for (; i + 4 <= point_count; i += 4) {
+    F32x4 x, y;
+    F32x4_Load_Vector2s(points + i, x, y);
+    F32x4 xx = F32x4_Mul(x, x);
+    F32x4 yy = F32x4_Mul(y, y);
+    F32x4 xxx = F32x4_Mul(xx, x);
+    F32x4 yyy = F32x4_Mul(yy, y);
+
+    F32x4 side = F32x4_Mul(F32x4_Set1(b->v_xxx), xxx);
+    side = F32x4_Add(side, F32x4_Mul(F32x4_Mul(F32x4_Set1(b->v_xxy), xx), y));
+    side = F32x4_Add(side, F32x4_Mul(F32x4_Mul(F32x4_Set1(b->v_xyy), x), yy));
+    side = F32x4_Add(side, F32x4_Mul(F32x4_Set1(b->v_yyy), yyy));
+    side = F32x4_Add(side, F32x4_Mul(F32x4_Set1(b->v_xx), xx));
+    side = F32x4_Add(side, F32x4_Mul(F32x4_Mul(F32x4_Set1(b->v_xy), x), y));
+    side = F32x4_Add(side, F32x4_Mul(F32x4_Set1(b->v_yy), yy));
+    side = F32x4_Add(side, F32x4_Mul(F32x4_Set1(b->v_x), x));
+    side = F32x4_Add(side, F32x4_Mul(F32x4_Set1(b->v_y), y));
+    side = F32x4_Add(side, F32x4_Set1(b->v_0));
+    F32x4_Store(sides + i, side);
+  }
+#endif
+
+  for (; i < point_count; ++i) {
+    sides[i] = evaluate_implicit_bezier(b, points[i]);
+  }
+}
@@ -149,10 +149,13 @@
 
 #include <stdint.h>
 typedef uint8_t U8;
+typedef uint16_t U16;
 typedef uint32_t U32;
+typedef uint64_t U64;
 typedef int32_t S32;
 typedef uint32_t B32;
 typedef float F32;
+typedef double F64;
 
 #define Min(a,b) (((a)<(b))?(a):(b))
 #define Max(a,b) (((a)>(b))?(a):(b))
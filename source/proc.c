@@ -7,7 +7,7 @@
    [ ] Fix naming collisions with Raylib and "Windows.h" !!!
 
    [x] Allow deleting of processes
-     [ ] BUG: Connect two process with two wires. Delete one wire. Reconnect a second wire. Now when you hover, it highlights the wrong wire.
+     [x] BUG: Connect two process with two wires. Delete one wire. Reconnect a second wire. Now when you hover, it highlights the wrong wire.
    [ ] File save and load
    [ ] Processes should expand to contain it's label
    [ ] Allow multi-selection of processes
@@ -19,12 +19,12 @@
    [ ] Make some sliders/fields for global settings like process-size and font-size.
    [ ] Show cursor when editing the text of a process.
    [x] Allow toggling on/off "mr4th style" process drawing, which is a variation on the visual style of diragrams in the book.
-     [ ] Move towards defining shapes using triangle strips/fans. We used some raylib funcs for circles and stuff just because it was easy, but now we need more control.
-     [ ] Implement collision detection for triangle strip/fan so we can just define a shape with triangles and be able to interact and draw with the same shape.
+     [x] Move towards defining shapes using triangle strips/fans. We used some raylib funcs for circles and stuff just because it was easy, but now we need more control.
+     [x] Implement collision detection for triangle strip/fan so we can just define a shape with triangles and be able to interact and draw with the same shape.
    [ ] If you toggle a process to be a special display (cup/cap/invisible), and then connect a new wire to it, the special visual still applies and you cannot toggle away. When connecting wires, we need to check if the special display flag should be unset.
    [ ] Undo/redo
    [ ] Allow reordering of connected wires
-   [ ] BUG: Connect a two processes. Make one process invisible. Delete the *other* process. The invisible process is still there but, well, you can't see it! Either delete the invisible one, or make it visible again. Probably just delete it??
+   [x] BUG: Connect a two processes. Make one process invisible. Delete the *other* process. The invisible process is still there but, well, you can't see it! Either delete the invisible one, or make it visible again. Probably just delete it??
 */
 
 #include "../source/mr4thbase_cherrypick.h"
@@ -34,9 +34,11 @@
 #if OS_WINDOWS
 # include "../libraries/raylib-5.5_win32_msvc16/include/raylib.h"
 # include "../libraries/raylib-5.5_win32_msvc16/include/raymath.h"
+# include "../libraries/raylib-5.5_win32_msvc16/include/rlgl.h"
 #elif OS_MAC
 # include "../libraries/raylib-5.5_macos/include/raylib.h"
 # include "../libraries/raylib-5.5_macos/include/raymath.h"
+# include "../libraries/raylib-5.5_macos/include/rlgl.h"
 #else
 # error We have not included the raylib release for this OS yet.
 #endif
@@ -51,15 +53,29 @@
 
 
 
-#define Process_Id U32
+/*
+  Process and wire ids are generational handles: the low 32 bits are the slot index and the high 32 bits are the slot's generation. Slots bump their generation when they are freed, so a stale id (e.g. a hot_id that outlived its process) no longer resolves once the slot is reused.
+*/
+#define Process_Id U64
+#define Wire_Id U64
+
+#define Id_Index(id)      ((U32)((id) & 0xffffffff))
+#define Id_Generation(id) ((U32)((id) >> 32))
+#define Make_Id(index, generation) (((U64)(generation) << 32) | (U64)(index))
 
 // TODO: Should Process_Flag just be a non-flag enum?
 typedef enum {
-  Process_Flag_Wire    = 1 << 0,
   Process_Flag_Empty   = 1 << 1,
   Process_Flag_Cup     = 1 << 2,
   Process_Flag_Cap     = 1 << 3,
   Process_Flag_Deleted = 1 << 4,
+
+  // NOTE: Transient flags, only set while delete_processes is running.
+  Process_Flag_Marked  = 1 << 5,
+  Process_Flag_Touched = 1 << 6,
+
+  // NOTE: Set while the process is waiting in the grid's dirty-list.
+  Process_Flag_SpatialDirty = 1 << 7,
 } Process_Flag;
 
 typedef enum {
@@ -85,18 +101,39 @@ typedef struct {
   S32 in_count;
   S32 out_count;
 
-  Process_Id in_id;
-  Process_Id out_id;
+  // NOTE: Offsets into the edge-arena for the ordered lists of wires attached to each port, so wire N on a port is just in_wires[N]/out_wires[N]. The lengths are in_count/out_count.
+  U32 in_wires;
+  U32 out_wires;
 
-  U32 which_in;
-  U32 which_out;
+  U32 generation;
+
+  // NOTE: Only meaningful for deleted processes, links to the next slot index in the free-list.
+  U32 next_free_index;
 
-  // TODO: Use a growable structure for strings.
-#define Process_Label_Size 64
-  U8 label[Process_Label_Size];
-  U32 label_cursor;
+  // NOTE: Offset of the label text in the label-arena, zero if the process has never been labeled. Labels are kept out of the process so per-frame loops don't drag the text through the cache.
+  U32 label;
 } Process;
 
+typedef struct {
+  U32 capacity;
+  U32 size;
+} Label_Header;
+
+/*
+  Wires live in their own table, separate from processes, so the wire-drawing loop only streams through these small records.
+
+  A deleted wire has out_id set to zero, and its in_id links to the next slot index in the wire free-list.
+*/
+typedef struct {
+  Process_Id out_id;
+  Process_Id in_id;
+  U32 which_out;
+  U32 which_in;
+  U32 generation;
+  // NOTE: The wire's leaf in the scene-tree, zero if it is not in the tree yet.
+  U32 scene_leaf;
+} Wire;
+
 typedef enum {
   Process_Shape_Triangle,
   Process_Shape_Quadrangle, // TODO: Do we need both Quadrangle and Rectangle?
@@ -106,19 +143,154 @@ typedef enum {
 } Process_Shape_Kind;
 
 
+/*
+  Every shape is a mesh of triangles over its points, plus a closed outline through them. Drawing fills the triangles and strokes the outline, and hit-testing tests the same triangles, so a process can be clicked exactly where it is drawn and neither has to know the shape's kind.
+
+  Triangles are indices into points, wound so their insides are on the negative side of every edge. That is the winding triangle_contains_point expects, and the counter-clockwise order raylib draws triangles in.
+*/
+#define Process_Shape_Max_Points 32
+#define Process_Shape_Max_Triangles (Process_Shape_Max_Points-2)
+#define Circle_Segment_Count 24
+
 typedef struct {
   Process_Shape_Kind kind;
-#define Process_Shape_Max_Points 16
-  Vector2 points[Process_Shape_Max_Points];
+  // NOTE: The corners of the points' bounds, kept as corners so the bounds test is exact. They come first, followed by the counts and triangles, so hit-tests that miss touch a single cache-line and hits on small shapes touch two.
+  Vector2 min;
+  Vector2 max;
+  S32 point_count;
   S32 triangle_count;
+  S32 outline_count;
+  U8 triangles[Process_Shape_Max_Triangles][3];
+  U8 outline[Process_Shape_Max_Points];
+  Vector2 points[Process_Shape_Max_Points];
   F32 radius;
-  S32 point_count;
   Vector2 center;
   Vector2 first_control;
   Vector2 second_control;
   B32 downward;
+  // NOTE: Offset of the cached port positions in the port-arena, in-ports first and then out-ports. Zero if the shape has no cached ports, then they are computed on demand.
+  U32 ports;
 } Process_Shape;
 
+/*
+  One entry per process slot in the shape-arena, pushed along with the slot. A shape only depends on these inputs (and the global shape settings, which bump the context's shape_epoch), so the cached shape is rebuilt only when one of them changes.
+*/
+typedef struct {
+  Vector2 position;
+  S32 in_count;
+  S32 out_count;
+  U32 flags;
+  // NOTE: Zero means the entry has never been built.
+  U32 epoch;
+  // NOTE: The port-list owned by this entry, kept across rebuilds so it is only reallocated when the port count outgrows it.
+  U32 ports;
+  Process_Shape shape;
+
+  // NOTE: Where the process is registered in the spatial grid. The bounds cover the shape, the wire-boxes and the new-wire-box.
+  B32 in_grid;
+  Rectangle bounds;
+  S32 cell_min_x;
+  S32 cell_min_y;
+  S32 cell_max_x;
+  S32 cell_max_y;
+
+  // NOTE: The process' leaf in the scene-tree, zero if it is not in the tree yet.
+  U32 scene_leaf;
+} Process_Shape_Cache;
+
+#define Process_Shape_Flags (Process_Flag_Empty|Process_Flag_Cup|Process_Flag_Cap)
+
+/*
+  The spatial grid is a hash of uniform cells, each bucket a chain of Grid_Nodes that point at the processes overlapping its cells. A process is in every cell its bounds overlap, so a point query only has to look at one bucket.
+
+  The grid-arena holds the bucket heads followed by the nodes. Node zero is unused, so zero ends a chain.
+*/
+#define Grid_Cell_Size 128.0f
+#define Grid_Bucket_Count (1 << 16)
+
+typedef struct {
+  U32 process_index;
+  U32 next;
+} Grid_Node;
+
+#define Get_Grid_Buckets(ga)\
+  ((U32 *)((ga)->Data))
+
+#define Get_Grid_Node(ga, node)\
+  ((Grid_Node *)((ga)->Data + Grid_Bucket_Count*sizeof(U32)) + (node))
+
+#define Get_Grid_Cell(x)\
+  ((S32)floorf((x) / Grid_Cell_Size))
+
+/*
+  The scene-tree is a dynamic bounding-volume hierarchy over process bounds and wire curves, for region queries (box and lasso selection, culling, overlap tests). It is kept balanced with AVL-style rotations.
+
+  Leaves store "fat" boxes, grown by Scene_Fat_Margin, so small moves like dragging only refit a leaf once it leaves its fat box. Node zero is unused, so zero means no node. Free nodes are linked through parent.
+*/
+#define Scene_Fat_Margin 16.0f
+#define Scene_Query_Stack_Size 256
+#define Scene_Item_Wire_Bit (1u << 31)
+
+typedef struct {
+  Rectangle box;
+  U32 parent;
+  U32 left;
+  U32 right;
+  // NOTE: Only meaningful for leaves, the slot index of the process or wire, with Scene_Item_Wire_Bit set for wires.
+  U32 item;
+  S32 height;
+} Scene_Node;
+
+#define Get_Scene_Node(na, node)\
+  ((Scene_Node *)((na)->Data) + (node))
+
+#define Scene_Node_Is_Leaf(n) ((n)->left == 0)
+
+/*
+  The cubic bezier a wire is drawn as.
+*/
+typedef struct {
+  Vector2 out_position;
+  Vector2 in_position;
+  Vector2 out_control;
+  Vector2 in_control;
+} Wire_Curve;
+
+#define Wire_Control_Offset 30.0f
+
+/*
+  Every wire keeps its curve flattened into a polyline, which is what gets drawn, picked and region-queried. It is refreshed whenever the wire's leaf in the scene-tree is refit, which happens whenever either end of the wire is marked spatially dirty, and for every wire in set_context_zoom.
+
+  The segment count adapts to the curve: enough segments that the polyline stays within Wire_Flatness_Tolerance pixels of the curve at the current zoom, so short wires get a handful of segments and long ones stay smooth.
+*/
+#define Wire_Flatness_Tolerance 0.5f
+#define Wire_Min_Segment_Count 2
+#define Wire_Max_Segment_Count 128
+#define Wire_Pick_Distance 5.0f
+
+typedef struct {
+  Rectangle bounds;
+  // NOTE: A port-list holding the polyline, owned by this entry and kept across refits so it is only reallocated when the wire needs more points.
+  U32 points;
+  S32 point_count;
+} Wire_Curve_Cache;
+
+#define Get_Wire_Curve_Cache(ca, index)\
+  ((Wire_Curve_Cache *)((ca)->Data) + (index))
+
+/*
+  Results of a region query, on the temp-arena.
+*/
+typedef struct {
+  Process_Id *process_ids;
+  S32 process_count;
+  Wire_Id *wire_ids;
+  S32 wire_count;
+} Scene_Query;
+
+#define Get_Process_Shape_Cache(sa, index)\
+  ((Process_Shape_Cache *)((sa)->Data) + (index))
+
 
 global_variable F32 global_process_wire_padding = 8.0f;
 global_variable F32 global_process_wire_spacing = 22.0f;
@@ -139,7 +311,6 @@ global_variable Color global_background_color = (Color){220, 220, 200, 255};
 
 global_variable S32 global_shape_fan_triangle_count = 12;
 
-#define Half_Circle_Fudge 1.32f
 #define Half_Circle_Radius_Fudge 1.0f
 
 
@@ -151,19 +322,84 @@ global_variable Process global_zero_process;
 
 #define Get_Process_Count(pa)  (((pa)->Offset/sizeof(Process))-1)
 
+// NOTE: Raw slot access, for walking the process table. Everything else should go through ids.
+#define Get_Process_Slot(pa, index)\
+  ((Process *)((pa)->Data) + (index))
+
 #define Process_Id_Is_Valid(pa, id)\
-  ((id) > 0 && (id) <= Get_Process_Count(pa))
+  (Id_Index(id) > 0 && Id_Index(id) <= Get_Process_Count(pa) &&\
+   Get_Process_Slot((pa), Id_Index(id))->generation == Id_Generation(id) &&\
+   !Get_Flag(Get_Process_Slot((pa), Id_Index(id))->flags, Process_Flag_Deleted))
 
 #define Get_Process_By_Id(pa, id)\
   (Process_Id_Is_Valid((pa), (id))\
-   ? (Process *)((pa)->Data + ((id)*sizeof(Process)))\
+   ? Get_Process_Slot((pa), Id_Index(id))\
    : Zero_Process())
 
+#define Get_Process_Index(pa, p)\
+  (((U8 *)(p) > (pa)->Data && (U8 *)(p) < (pa)->Data + (pa)->Offset)\
+   ? (U32)((Process *)(p) - (Process *)((pa)->Data))\
+   : 0)
+
 #define Get_Process_Id(pa, p)\
-  (((U8 *)(p) > (pa)->Data)\
-   ? (U32)(((U8 *)(p)-((pa)->Data))/sizeof(Process))\
+  (Get_Process_Index((pa), (p))\
+   ? Make_Id(Get_Process_Index((pa), (p)), ((Process *)(p))->generation)\
+   : 0)
+
+
+global_variable Wire global_zero_wire;
+#define Zero_Wire()\
+  ((global_zero_wire=(Wire){}),\
+   &global_zero_wire)
+
+#define Get_Wire_Count(wa)  (((wa)->Offset/sizeof(Wire))-1)
+
+#define Wire_Is_Deleted(w) ((w)->out_id == 0)
+
+// NOTE: Raw slot access, for walking the wire table. Everything else should go through ids.
+#define Get_Wire_Slot(wa, index)\
+  ((Wire *)((wa)->Data) + (index))
+
+#define Wire_Id_Is_Valid(wa, id)\
+  (Id_Index(id) > 0 && Id_Index(id) <= Get_Wire_Count(wa) &&\
+   Get_Wire_Slot((wa), Id_Index(id))->generation == Id_Generation(id) &&\
+   !Wire_Is_Deleted(Get_Wire_Slot((wa), Id_Index(id))))
+
+#define Get_Wire_By_Id(wa, id)\
+  (Wire_Id_Is_Valid((wa), (id))\
+   ? Get_Wire_Slot((wa), Id_Index(id))\
+   : Zero_Wire())
+
+#define Get_Wire_Index(wa, w)\
+  (((U8 *)(w) > (wa)->Data && (U8 *)(w) < (wa)->Data + (wa)->Offset)\
+   ? (U32)((Wire *)(w) - (Wire *)((wa)->Data))\
    : 0)
 
+#define Get_Wire_Id(wa, w)\
+  (Get_Wire_Index((wa), (w))\
+   ? Make_Id(Get_Wire_Index((wa), (w)), ((Wire *)(w))->generation)\
+   : 0)
+
+// NOTE: While delete_processes is running, wires marked for deletion have which_in set to this.
+#define Wire_Marked ((U32)-1)
+
+
+/*
+  Inputs to build_diagram. Wire_Desc refers to processes by their index in the Process_Desc array, and the order of the Wire_Desc array is the port order on both ends.
+*/
+typedef struct {
+  Vector2 position;
+  // NOTE: Any of Process_Flag_Empty, Process_Flag_Cup and Process_Flag_Cap.
+  U32 flags;
+  // NOTE: Optional, null-terminated.
+  const char *label;
+} Process_Desc;
+
+typedef struct {
+  U32 out_process;
+  U32 in_process;
+} Wire_Desc;
+
 
 // TODO: maybe this should be a mode and not flags?
 typedef enum {
@@ -173,15 +409,72 @@ typedef enum {
   Context_Flag_RoundedShapes  = 1 << 3,
 } Context_Flag;
 
+#define Wire_List_Min_Capacity 4
+#define Wire_List_Class_Count 24
+
+#define Get_Wire_List(ea, list)\
+  ((Wire_Id *)((ea)->Data) + (list))
+
+#define Get_Wire_List_Capacity(ea, list)\
+  ((list) ? Get_Wire_List((ea), (list))[-1] : 0)
+
+#define Port_List_Min_Capacity 8
+#define Port_List_Class_Count 24
+
+#define Get_Port_List(ra, list)\
+  ((Vector2 *)((ra)->Data) + (list))
+
+// NOTE: The capacity is kept in the Vector2 slot before the list.
+#define Get_Port_List_Capacity(ra, list)\
+  ((list) ? *(U32 *)(Get_Port_List((ra), (list)) - 1) : 0)
+
+#define Label_Min_Capacity 16
+#define Label_Class_Count 24
+
+#define Get_Label_Header(la, label)\
+  ((Label_Header *)((la)->Data + (label)) - 1)
+
+#define Get_Label_Text(la, label)\
+  ((char *)((la)->Data + (label)))
+
+#define Get_Label_Size(la, label)\
+  ((label) ? Get_Label_Header((la), (label))->size : 0)
+
 typedef struct {
   arena render_arena;
   arena process_arena;
+  arena wire_arena;
+  arena edge_arena;
+  arena label_arena;
+  arena shape_arena;
+  arena port_arena;
+  arena grid_arena;
+  arena spatial_dirty_arena;
+  arena scene_arena;
+  arena wire_curve_arena;
   arena temp_arena;
   U32 flags;
-
-  Process_Id first_free_process_id;
+  U32 shape_epoch;
+  // NOTE: Screen pixels per diagram unit. Only the wire flattening looks at it so far.
+  F32 zoom;
+
+  U32 first_free_process_index;
+  U32 first_free_wire_index;
+  U32 free_process_count;
+  U32 free_wire_count;
+  // NOTE: The generation that slots pushed onto the end of the tables start from. Compaction raises it past every slot it drops.
+  U32 process_generation_floor;
+  U32 wire_generation_floor;
+  U32 first_free_wire_list[Wire_List_Class_Count];
+  U32 first_free_label[Label_Class_Count];
+  U32 first_free_port_list[Port_List_Class_Count];
+  U32 first_free_grid_node;
+  U32 scene_root;
+  U32 first_free_scene_node;
   Process_Id hot_id;
   Process_Id active_id;
+  Wire_Id hot_wire_id;
+  Wire_Id active_wire_id;
 
   Vector2 mouse_position;
   Vector2 active_position;
@@ -202,7 +495,7 @@ function Vector2 get_percentage_between_points(Vector2 p0, Vector2 p1, F32 perce
 function Vector2 get_process_position(Context *context, Process *process) {
   arena *pa = &context->process_arena;
 
-  U32 id = Get_Process_Id(pa, process);
+  Process_Id id = Get_Process_Id(pa, process);
   B32 is_active = context->active_id == id;
   B32 is_dragging = Get_Flag(context->flags, Context_Flag_Dragging);
 
@@ -219,49 +512,95 @@ function Vector2 get_process_position(Context *context, Process *process) {
 
 
 
-function Vector2
-get_process_wire_out_position(Context *context, Process *p, Process_Shape shape, U32 wire_index) {
-  Vector2 p0 = shape.points[0];
-  Vector2 p1 = shape.points[1];
-
-  if (shape.kind == Process_Shape_HalfCircle) {
-    p0 = shape.points[shape.point_count-1];
-    p1 = shape.points[0];
+/*
+  The in-ports are spread along the bottom edge of a shape and the out-ports along the top edge. Start is the end of the edge that port 0 is closest to.
+*/
+function void
+get_process_port_edge(Process_Shape *shape, B32 is_out, Vector2 *start, Vector2 *end) {
+  if (is_out) {
+    *end = shape->points[0];
+    *start = shape->points[1];
+
+    if (shape->kind == Process_Shape_HalfCircle) {
+      *end = shape->points[shape->point_count-1];
+      *start = shape->points[0];
+    }
+  } else {
+    *end = shape->points[2];
+    *start = shape->points[1];
+
+    if (shape->kind == Process_Shape_HalfCircle) {
+      // @Copypasta draw_processes
+      *end = shape->points[0];
+      *start = shape->points[shape->point_count-1];
+    } else if (shape->point_count == 4) {
+      *end = shape->points[2];
+      *start = shape->points[3];
+    }
   }
+}
 
-  Vector2 delta = Vector2Subtract(p0, p1);
+
+function Vector2
+get_process_port_position(Vector2 start, Vector2 end, S32 port_count, U32 wire_index) {
+  Vector2 delta = Vector2Subtract(end, start);
   Vector2 delta_norm = Vector2Normalize(delta);
-  F32 inner_distance = fmax(0.0f, Vector2Distance(p0, p1) - 2.0f*global_process_wire_padding);
-  F32 chunk_size = inner_distance / (F32)(p->out_count+1);
+  F32 inner_distance = fmax(0.0f, Vector2Distance(end, start) - 2.0f*global_process_wire_padding);
+  F32 chunk_size = inner_distance / (F32)(port_count+1);
   F32 distance_from_point = global_process_wire_padding + chunk_size*(F32)(wire_index+1);
 
-  Vector2 out_position = Vector2Add(p1, Vector2Scale(delta_norm, distance_from_point));
+  Vector2 position = Vector2Add(start, Vector2Scale(delta_norm, distance_from_point));
 
-  return out_position;
+  return position;
+}
+
+
+/*
+  Compute every port position of a process into ports, in-ports first and then out-ports. Only done when the shape is rebuilt.
+*/
+function void
+fill_out_process_ports(Process_Shape *shape, Process *p, Vector2 *ports) {
+  Vector2 start, end;
+
+  get_process_port_edge(shape, 0, &start, &end);
+  for (S32 i = 0; i < p->in_count; ++i) {
+    ports[i] = get_process_port_position(start, end, p->in_count, i);
+  }
+
+  get_process_port_edge(shape, 1, &start, &end);
+  for (S32 i = 0; i < p->out_count; ++i) {
+    ports[p->in_count + i] = get_process_port_position(start, end, p->out_count, i);
+  }
 }
 
 
 function Vector2
-get_process_wire_in_position(Context *context, Process *p, Process_Shape shape, U32 wire_index) {
-  Vector2 p0 = shape.points[2];
-  Vector2 p1 = shape.points[1];
+get_process_wire_out_position(Context *context, Process *p, Process_Shape *shape, U32 wire_index) {
+  Vector2 out_position;
 
-  if (shape.kind == Process_Shape_HalfCircle) {
-    // @Copypasta draw_processes
-    p0 = shape.points[0];
-    p1 = shape.points[shape.point_count-1];
-  } else if (shape.point_count == 4) {
-    p0 = shape.points[2];
-    p1 = shape.points[3];
+  if (shape->ports) {
+    out_position = Get_Port_List(&context->port_arena, shape->ports)[p->in_count + wire_index];
+  } else {
+    Vector2 start, end;
+    get_process_port_edge(shape, 1, &start, &end);
+    out_position = get_process_port_position(start, end, p->out_count, wire_index);
   }
 
-  Vector2 delta = Vector2Subtract(p0, p1);
-  Vector2 delta_norm = Vector2Normalize(delta);
-  F32 inner_distance = fmax(0.0f, Vector2Distance(p0, p1) - 2.0f*global_process_wire_padding);
-  F32 chunk_size = inner_distance / (F32)(p->in_count+1);
-  F32 distance_from_point = global_process_wire_padding + chunk_size*(F32)(wire_index+1);
+  return out_position;
+}
+
 
-  Vector2 in_position = Vector2Add(p1, Vector2Scale(delta_norm, distance_from_point));
+function Vector2
+get_process_wire_in_position(Context *context, Process *p, Process_Shape *shape, U32 wire_index) {
+  Vector2 in_position;
+
+  if (shape->ports) {
+    in_position = Get_Port_List(&context->port_arena, shape->ports)[wire_index];
+  } else {
+    Vector2 start, end;
+    get_process_port_edge(shape, 0, &start, &end);
+    in_position = get_process_port_position(start, end, p->in_count, wire_index);
+  }
 
   return in_position;
 }
@@ -276,20 +615,20 @@ function Rectangle get_wire_box(Context *context, Vector2 position) {
 }
 
 
-function Vector2 get_new_wire_position(Context *context, Process *p, Process_Shape shape) {
-  Vector2 position = shape.points[0];
+function Vector2 get_new_wire_position(Context *context, Process *p, Process_Shape *shape) {
+  Vector2 position = shape->points[0];
 
-  if (shape.kind == Process_Shape_Circle) {
-    position.x = shape.center.x;
-    position.y = shape.center.y - shape.radius;
-  } else if (shape.kind == Process_Shape_HalfCircle) {
-    if (shape.downward) {
-      position.x = shape.points[shape.point_count-1].x;
-      position.y = shape.points[shape.point_count-1].y;
+  if (shape->kind == Process_Shape_Circle) {
+    position.x = shape->center.x;
+    position.y = shape->center.y - shape->radius;
+  } else if (shape->kind == Process_Shape_HalfCircle) {
+    if (shape->downward) {
+      position.x = shape->points[shape->point_count-1].x;
+      position.y = shape->points[shape->point_count-1].y;
     } else {
       Vector2 point = get_bezier_point(
-        shape.points[0], shape.points[shape.point_count-1],
-        shape.first_control, shape.second_control,
+        shape->points[0], shape->points[shape->point_count-1],
+        shape->first_control, shape->second_control,
         0.5f);
       position.x = point.x;
       position.y = point.y;
@@ -300,10 +639,10 @@ function Vector2 get_new_wire_position(Context *context, Process *p, Process_Sha
 }
 
 
-function Rectangle get_new_wire_box(Context *context, Process *p, Process_Shape shape) {
+function Rectangle get_new_wire_box(Context *context, Process *p, Process_Shape *shape) {
   // NOTE: Currently, the first point of any process-shape is always the corner where the new-wire-box wants to be.
-  F32 x = shape.points[0].x;
-  F32 y = shape.points[0].y;
+  F32 x = shape->points[0].x;
+  F32 y = shape->points[0].y;
 
   Vector2 position = get_new_wire_position(context, p, shape);
 
@@ -328,311 +667,2034 @@ function B32 rectangle_contains_point(Rectangle r, Vector2 p) {
 }
 
 
+function B32 rectangle_contains_rectangle(Rectangle outer, Rectangle inner) {
+  B32 contains = (inner.x >= outer.x && inner.y >= outer.y &&
+                  inner.x + inner.width <= outer.x + outer.width &&
+                  inner.y + inner.height <= outer.y + outer.height);
+  return contains;
+}
+
+
+function B32 rectangles_overlap(Rectangle a, Rectangle b) {
+  B32 overlap = (a.x <= b.x + b.width && b.x <= a.x + a.width &&
+                 a.y <= b.y + b.height && b.y <= a.y + a.height);
+  return overlap;
+}
+
+
+function Rectangle get_rectangle_union(Rectangle a, Rectangle b) {
+  F32 min_x = Min(a.x, b.x);
+  F32 min_y = Min(a.y, b.y);
+  F32 max_x = Max(a.x + a.width, b.x + b.width);
+  F32 max_y = Max(a.y + a.height, b.y + b.height);
+  Rectangle r = (Rectangle){min_x, min_y, max_x - min_x, max_y - min_y};
+  return r;
+}
+
+
+function F32 get_rectangle_perimeter(Rectangle r) {
+  F32 perimeter = 2.0f*(r.width + r.height);
+  return perimeter;
+}
+
+
+function Rectangle get_points_bounds(Vector2 *points, S32 point_count) {
+  Rectangle bounds = (Rectangle){points[0].x, points[0].y, 0.0f, 0.0f};
+  for (S32 i = 1; i < point_count; ++i) {
+    bounds = get_rectangle_union(bounds, (Rectangle){points[i].x, points[i].y, 0.0f, 0.0f});
+  }
+  return bounds;
+}
+
 
 
-function Process *get_process_wire_by_selection(Context *context, Process_Selection selection) {
+
+function Wire *get_process_wire_by_selection(Context *context, Process_Selection selection) {
   arena *pa = &context->process_arena;
-  Process *wire = 0;
-  S32 pc = Get_Process_Count(pa);
-  S32 match_count = 0;
+  arena *wa = &context->wire_arena;
+  arena *ea = &context->edge_arena;
+  Wire *wire = 0;
+  Process *p = Get_Process_By_Id(pa, selection.process_id);
+
+  if (selection.type == Process_Selection_In &&
+      selection.index >= 0 && selection.index < p->in_count) {
+    Wire_Id wire_id = Get_Wire_List(ea, p->in_wires)[selection.index];
+    wire = Get_Wire_By_Id(wa, wire_id);
+  } else if (selection.type == Process_Selection_Out &&
+             selection.index >= 0 && selection.index < p->out_count) {
+    Wire_Id wire_id = Get_Wire_List(ea, p->out_wires)[selection.index];
+    wire = Get_Wire_By_Id(wa, wire_id);
+  }
 
-  for (S32 i = 1; i <= pc; ++i) {
-    Process *p = Get_Process_By_Id(pa, i);
-    if (Get_Flag(p->flags, Process_Flag_Wire)) {
-      if (selection.type == Process_Selection_In && p->in_id == selection.process_id) {
-        // matching in-wire
-        if (match_count == selection.index) {
-          wire = p;
-          break;
-        } else {
-          match_count += 1;
-        }
-      } else if (selection.type == Process_Selection_Out && p->out_id == selection.process_id) {
-        // matching out-wire
-        if (match_count == selection.index) {
-          wire = p;
-          break;
-        } else {
-          match_count += 1;
-        }
+  return wire;
+}
+
+
+
+
+/*
+  Wire-lists are blocks of wire-ids in the edge-arena, bucketed by power-of-two capacity. Each block is preceded by its capacity, and freed blocks are kept in per-capacity free-lists (linked through their first element) so they can be reused by any process.
+*/
+function U32 get_size_class(U32 min_capacity, U32 capacity) {
+  U32 size_class = 0;
+
+  while ((min_capacity << size_class) < capacity) {
+    size_class += 1;
+  }
+
+  return size_class;
+}
+
+
+function U32 allocate_wire_list(Context *context, U32 capacity) {
+  arena *ea = &context->edge_arena;
+  U32 size_class = get_size_class(Wire_List_Min_Capacity, capacity);
+  U32 list = 0;
+
+  if (size_class < Wire_List_Class_Count) {
+    list = context->first_free_wire_list[size_class];
+
+    if (list) {
+      // pop from the free-list
+      context->first_free_wire_list[size_class] = (U32)Get_Wire_List(ea, list)[0];
+    } else {
+      U32 class_capacity = Wire_List_Min_Capacity << size_class;
+      Wire_Id *block = ryn_memory_PushArray(ea, Wire_Id, class_capacity+1);
+
+      if (block) {
+        block[0] = class_capacity;
+        list = (U32)(block - Get_Wire_List(ea, 0)) + 1;
       }
     }
   }
 
-  return wire;
+  return list;
 }
 
 
+function void free_wire_list(Context *context, U32 list) {
+  arena *ea = &context->edge_arena;
 
+  if (list) {
+    U32 size_class = get_size_class(Wire_List_Min_Capacity, Get_Wire_List_Capacity(ea, list));
+    Get_Wire_List(ea, list)[0] = context->first_free_wire_list[size_class];
+    context->first_free_wire_list[size_class] = list;
+  }
+}
 
-function Process *create_process(Context *context) {
-  arena *pa = &context->process_arena;
-  Process *p = 0;
-  S32 pc = Get_Process_Count(pa);
 
-  for (S32 i = 1; i <= pc; ++i) {
-    Process *test_p = Get_Process_By_Id(pa, i);
-    if (Get_Flag(test_p->flags, Process_Flag_Deleted)) {
-      p = test_p;
-      *p = (Process){0};
-      break;
+/*
+  Writes wire_id at position "count" of the list, growing the list if needed. The caller owns the count, so nothing is committed until the caller increments it.
+*/
+function B32 push_wire_list(Context *context, U32 *list, S32 count, Wire_Id wire_id) {
+  arena *ea = &context->edge_arena;
+  B32 pushed = 1;
+
+  if (count + 1 > Get_Wire_List_Capacity(ea, *list)) {
+    U32 new_list = allocate_wire_list(context, count + 1);
+
+    if (new_list) {
+      Wire_Id *old_ids = Get_Wire_List(ea, *list);
+      Wire_Id *new_ids = Get_Wire_List(ea, new_list);
+      for (S32 i = 0; i < count; ++i) {
+        new_ids[i] = old_ids[i];
+      }
+
+      free_wire_list(context, *list);
+      *list = new_list;
+    } else {
+      pushed = 0;
     }
   }
 
-  if (!p) {
-    p = ryn_memory_PushZeroStruct(pa, Process);
+  if (pushed) {
+    Get_Wire_List(ea, *list)[count] = wire_id;
   }
 
-  return p;
+  return pushed;
 }
 
 
 
 
-function void delete_process(Context *context, Process *p) {
-  arena *pa = &context->process_arena;
-  S32 pc = Get_Process_Count(pa);
-  Process_Id id = Get_Process_Id(pa, p);
+/*
+  Port-lists hold the cached port positions of a process shape and the flattened curve of a wire, pooled by power-of-two capacity like wire-lists.
+*/
+function U32 allocate_port_list(Context *context, U32 capacity) {
+  arena *ra = &context->port_arena;
+  U32 size_class = get_size_class(Port_List_Min_Capacity, capacity);
+  U32 list = 0;
 
-  // if deleting a wire, adjust connected processes
-  if (Get_Flag(p->flags, Process_Flag_Wire)) {
-    B32 in_matched = 0;
-    B32 out_matched = 0;
-
-    for (S32 j = 1; j <= pc; ++j) {
-      Process *test_wire = Get_Process_By_Id(pa, j);
-      // adjust in-connections that come after deleted wire
-      if (test_wire->in_id == p->in_id && test_wire->which_in > p->which_in) {
-        test_wire->which_in -= 1;
-        in_matched = 1;
-      }
+  if (size_class < Port_List_Class_Count) {
+    list = context->first_free_port_list[size_class];
+
+    if (list) {
+      // pop from the free-list
+      context->first_free_port_list[size_class] = *(U32 *)Get_Port_List(ra, list);
+    } else {
+      U32 class_capacity = Port_List_Min_Capacity << size_class;
+      Vector2 *block = ryn_memory_PushArray(ra, Vector2, class_capacity+1);
 
-      // adjust out-connections that come after deleted wire
-      if (test_wire->out_id == p->out_id && test_wire->which_out > p->which_out) {
-        test_wire->which_out -= 1;
-        out_matched = 1;
+      if (block) {
+        *(U32 *)block = class_capacity;
+        list = (U32)(block - Get_Port_List(ra, 0)) + 1;
       }
     }
+  }
+
+  return list;
+}
+
+
+function void free_port_list(Context *context, U32 list) {
+  arena *ra = &context->port_arena;
+
+  if (list) {
+    U32 size_class = get_size_class(Port_List_Min_Capacity, Get_Port_List_Capacity(ra, list));
+    *(U32 *)Get_Port_List(ra, list) = context->first_free_port_list[size_class];
+    context->first_free_port_list[size_class] = list;
+  }
+}
+
+
+
+
+/*
+  Labels are null-terminated strings in the label-arena, each preceded by a Label_Header. Like wire-lists, they are bucketed by power-of-two capacity and freed labels are reused through per-capacity free-lists.
+*/
+function U32 allocate_label(Context *context, U32 capacity) {
+  arena *la = &context->label_arena;
+  U32 size_class = get_size_class(Label_Min_Capacity, capacity);
+  U32 label = 0;
+
+  if (size_class < Label_Class_Count) {
+    label = context->first_free_label[size_class];
+
+    if (label) {
+      // pop from the free-list
+      context->first_free_label[size_class] = *(U32 *)Get_Label_Text(la, label);
+    } else {
+      U32 class_capacity = Label_Min_Capacity << size_class;
+      Label_Header *header = (Label_Header *)PushSize(la, sizeof(Label_Header) + class_capacity);
 
-    B32 only_in_conn = p->in_id != 0 && p->which_in == 0;
-    B32 only_out_conn = p->out_id != 0 && p->which_out == 0;
+      if (header) {
+        header->capacity = class_capacity;
+        label = (U32)((U8 *)(header + 1) - la->Data);
+      }
+    }
 
-    // decrement process' in-count
-    if (in_matched || only_in_conn) {
-      Process *conn_proc = Get_Process_By_Id(pa, p->in_id);
-      conn_proc->in_count -= 1;
+    if (label) {
+      Get_Label_Header(la, label)->size = 0;
+      Get_Label_Text(la, label)[0] = 0;
     }
+  }
+
+  return label;
+}
+
+
+function void free_label(Context *context, U32 label) {
+  arena *la = &context->label_arena;
+
+  if (label) {
+    U32 size_class = get_size_class(Label_Min_Capacity, Get_Label_Header(la, label)->capacity);
+    *(U32 *)Get_Label_Text(la, label) = context->first_free_label[size_class];
+    context->first_free_label[size_class] = label;
+  }
+}
+
+
+function const char *get_process_label(Context *context, Process *p) {
+  arena *la = &context->label_arena;
+  const char *text = p->label ? Get_Label_Text(la, p->label) : "";
+  return text;
+}
+
+
+function void push_label_char(Context *context, Process *p, U8 c) {
+  arena *la = &context->label_arena;
+  U32 size = Get_Label_Size(la, p->label);
+  // NOTE: Leave room for the null-terminator.
+  U32 needed_capacity = size + 2;
+
+  if (!p->label || needed_capacity > Get_Label_Header(la, p->label)->capacity) {
+    U32 new_label = allocate_label(context, needed_capacity);
 
-    // decrement process' out-count
-    if (out_matched || only_out_conn) {
-      Process *conn_proc = Get_Process_By_Id(pa, p->out_id);
-      conn_proc->out_count -= 1;
+    if (new_label) {
+      char *old_text = Get_Label_Text(la, p->label);
+      char *new_text = Get_Label_Text(la, new_label);
+      for (U32 i = 0; i < size; ++i) {
+        new_text[i] = old_text[i];
+      }
+
+      free_label(context, p->label);
+      p->label = new_label;
     }
   }
 
-  // clear out the deleted process
-  *p = (Process){0};
-  Set_Flag(p->flags, Process_Flag_Deleted);
-  context->active_id = 0;
+  if (p->label && needed_capacity <= Get_Label_Header(la, p->label)->capacity) {
+    char *text = Get_Label_Text(la, p->label);
+    text[size] = c;
+    text[size+1] = 0;
+    Get_Label_Header(la, p->label)->size = size + 1;
+  }
+}
 
-  // check for wires connected to the deleted process, and delete those also
-  for (S32 i = 1; i <= pc; ++i) {
-    Process *wire = Get_Process_By_Id(pa, i);
 
-    B32 in_match = wire->in_id == id;
-    B32 out_match = wire->out_id == id;
+function void pop_label_char(Context *context, Process *p) {
+  arena *la = &context->label_arena;
+  U32 size = Get_Label_Size(la, p->label);
+
+  if (size > 0) {
+    Get_Label_Text(la, p->label)[size-1] = 0;
+    Get_Label_Header(la, p->label)->size = size - 1;
+  }
+}
+
+
+
+
+function U32 get_grid_bucket(S32 cell_x, S32 cell_y) {
+  U32 hash = ((U32)cell_x * 73856093u) ^ ((U32)cell_y * 19349663u);
+  U32 bucket = hash & (Grid_Bucket_Count - 1);
+  return bucket;
+}
 
-    if (in_match || out_match) {
-      if (!in_match) {
-        Process *conn_proc = Get_Process_By_Id(pa, wire->in_id);
 
-        // adjust in-connections to deleted wire
-        for (S32 j = 1; j <= pc; ++j) {
-          Process *test_wire = Get_Process_By_Id(pa, j);
-          if (test_wire->in_id == wire->in_id &&
-              test_wire->which_in > wire->which_in) {
-            test_wire->which_in -= 1;
-          }
-        }
+function void grid_insert(Context *context, U32 process_index, S32 cell_x, S32 cell_y) {
+  arena *ga = &context->grid_arena;
+  U32 node = context->first_free_grid_node;
+
+  if (node) {
+    // pop from the free-list
+    context->first_free_grid_node = Get_Grid_Node(ga, node)->next;
+  } else {
+    Grid_Node *new_node = ryn_memory_PushStruct(ga, Grid_Node);
+    node = new_node ? (U32)(new_node - Get_Grid_Node(ga, 0)) : 0;
+  }
+
+  if (node) {
+    U32 *bucket = Get_Grid_Buckets(ga) + get_grid_bucket(cell_x, cell_y);
+    Get_Grid_Node(ga, node)->process_index = process_index;
+    Get_Grid_Node(ga, node)->next = *bucket;
+    *bucket = node;
+  }
+}
+
+
+function void grid_remove(Context *context, U32 process_index, S32 cell_x, S32 cell_y) {
+  arena *ga = &context->grid_arena;
+  U32 *link = Get_Grid_Buckets(ga) + get_grid_bucket(cell_x, cell_y);
+
+  while (*link && Get_Grid_Node(ga, *link)->process_index != process_index) {
+    link = &Get_Grid_Node(ga, *link)->next;
+  }
+
+  if (*link) {
+    U32 node = *link;
+    *link = Get_Grid_Node(ga, node)->next;
+
+    // push onto the free-list
+    Get_Grid_Node(ga, node)->next = context->first_free_grid_node;
+    context->first_free_grid_node = node;
+  }
+}
+
+
+function void remove_process_from_grid(Context *context, U32 process_index) {
+  Process_Shape_Cache *cache = Get_Process_Shape_Cache(&context->shape_arena, process_index);
+
+  if (cache->in_grid) {
+    for (S32 y = cache->cell_min_y; y <= cache->cell_max_y; ++y) {
+      for (S32 x = cache->cell_min_x; x <= cache->cell_max_x; ++x) {
+        grid_remove(context, process_index, x, y);
+      }
+    }
+    cache->in_grid = 0;
+  }
+}
+
+
+function U32 allocate_scene_node(Context *context) {
+  arena *na = &context->scene_arena;
+  U32 node = context->first_free_scene_node;
+
+  if (node) {
+    // pop from the free-list
+    context->first_free_scene_node = Get_Scene_Node(na, node)->parent;
+  } else {
+    Scene_Node *new_node = ryn_memory_PushStruct(na, Scene_Node);
+    node = new_node ? (U32)(new_node - Get_Scene_Node(na, 0)) : 0;
+  }
+
+  if (node) {
+    *Get_Scene_Node(na, node) = (Scene_Node){0};
+  }
+
+  return node;
+}
+
+
+function void free_scene_node(Context *context, U32 node) {
+  arena *na = &context->scene_arena;
+  Get_Scene_Node(na, node)->height = -1;
+
+  // push onto the free-list
+  Get_Scene_Node(na, node)->parent = context->first_free_scene_node;
+  context->first_free_scene_node = node;
+}
+
+
+function void replace_scene_child(Context *context, U32 parent, U32 old_child, U32 new_child) {
+  arena *na = &context->scene_arena;
+
+  if (parent) {
+    Scene_Node *p = Get_Scene_Node(na, parent);
+    if (p->left == old_child) {
+      p->left = new_child;
+    } else {
+      p->right = new_child;
+    }
+  } else {
+    context->scene_root = new_child;
+  }
+}
+
+
+/*
+  If one child of a is more than one level taller than the other, rotate the taller child up into a's place. Returns the node now at a's place.
+*/
+function U32 balance_scene_node(Context *context, U32 ia) {
+  arena *na = &context->scene_arena;
+  Scene_Node *a = Get_Scene_Node(na, ia);
+  U32 result = ia;
+
+  if (!Scene_Node_Is_Leaf(a) && a->height >= 2) {
+    U32 ib = a->left;
+    U32 ic = a->right;
+    Scene_Node *b = Get_Scene_Node(na, ib);
+    Scene_Node *c = Get_Scene_Node(na, ic);
+    S32 balance = c->height - b->height;
+
+    if (balance > 1) {
+      // rotate c up
+      U32 i_f = c->left;
+      U32 i_g = c->right;
+      Scene_Node *f = Get_Scene_Node(na, i_f);
+      Scene_Node *g = Get_Scene_Node(na, i_g);
+
+      c->left = ia;
+      c->parent = a->parent;
+      a->parent = ic;
+      replace_scene_child(context, c->parent, ia, ic);
+
+      if (f->height > g->height) {
+        c->right = i_f;
+        a->right = i_g;
+        g->parent = ia;
+        a->box = get_rectangle_union(b->box, g->box);
+        c->box = get_rectangle_union(a->box, f->box);
+        a->height = 1 + Max(b->height, g->height);
+        c->height = 1 + Max(a->height, f->height);
+      } else {
+        c->right = i_g;
+        a->right = i_f;
+        f->parent = ia;
+        a->box = get_rectangle_union(b->box, f->box);
+        c->box = get_rectangle_union(a->box, g->box);
+        a->height = 1 + Max(b->height, f->height);
+        c->height = 1 + Max(a->height, g->height);
+      }
+
+      result = ic;
+    } else if (balance < -1) {
+      // rotate b up
+      U32 i_d = b->left;
+      U32 i_e = b->right;
+      Scene_Node *d = Get_Scene_Node(na, i_d);
+      Scene_Node *e = Get_Scene_Node(na, i_e);
+
+      b->left = ia;
+      b->parent = a->parent;
+      a->parent = ib;
+      replace_scene_child(context, b->parent, ia, ib);
+
+      if (d->height > e->height) {
+        b->right = i_d;
+        a->left = i_e;
+        e->parent = ia;
+        a->box = get_rectangle_union(c->box, e->box);
+        b->box = get_rectangle_union(a->box, d->box);
+        a->height = 1 + Max(c->height, e->height);
+        b->height = 1 + Max(a->height, d->height);
+      } else {
+        b->right = i_e;
+        a->left = i_d;
+        d->parent = ia;
+        a->box = get_rectangle_union(c->box, d->box);
+        b->box = get_rectangle_union(a->box, e->box);
+        a->height = 1 + Max(c->height, d->height);
+        b->height = 1 + Max(a->height, e->height);
+      }
+
+      result = ib;
+    }
+  }
+
+  return result;
+}
+
+
+/*
+  Walk from node up to the root, rebalancing and refitting every ancestor.
+*/
+function void refit_scene_ancestors(Context *context, U32 node) {
+  arena *na = &context->scene_arena;
+
+  while (node) {
+    node = balance_scene_node(context, node);
+
+    Scene_Node *n = Get_Scene_Node(na, node);
+    Scene_Node *left = Get_Scene_Node(na, n->left);
+    Scene_Node *right = Get_Scene_Node(na, n->right);
+    n->height = 1 + Max(left->height, right->height);
+    n->box = get_rectangle_union(left->box, right->box);
+
+    node = n->parent;
+  }
+}
+
+
+/*
+  Insert a leaf next to the sibling that grows the tree's total perimeter the least, descending while that is cheaper than pairing with the current node.
+*/
+function void insert_scene_leaf(Context *context, U32 leaf) {
+  arena *na = &context->scene_arena;
+  Rectangle leaf_box = Get_Scene_Node(na, leaf)->box;
+
+  if (!context->scene_root) {
+    context->scene_root = leaf;
+    Get_Scene_Node(na, leaf)->parent = 0;
+  } else {
+    U32 sibling = context->scene_root;
+
+    while (!Scene_Node_Is_Leaf(Get_Scene_Node(na, sibling))) {
+      Scene_Node *n = Get_Scene_Node(na, sibling);
+      Scene_Node *left = Get_Scene_Node(na, n->left);
+      Scene_Node *right = Get_Scene_Node(na, n->right);
+
+      F32 perimeter = get_rectangle_perimeter(n->box);
+      F32 combined_perimeter = get_rectangle_perimeter(get_rectangle_union(n->box, leaf_box));
+
+      // cost of pairing the leaf with this node, and the cost every child pays for this node growing
+      F32 cost = 2.0f*combined_perimeter;
+      F32 inheritance_cost = 2.0f*(combined_perimeter - perimeter);
+
+      F32 left_cost = get_rectangle_perimeter(get_rectangle_union(left->box, leaf_box)) + inheritance_cost;
+      if (!Scene_Node_Is_Leaf(left)) {
+        left_cost -= get_rectangle_perimeter(left->box);
+      }
+      F32 right_cost = get_rectangle_perimeter(get_rectangle_union(right->box, leaf_box)) + inheritance_cost;
+      if (!Scene_Node_Is_Leaf(right)) {
+        right_cost -= get_rectangle_perimeter(right->box);
+      }
+
+      if (cost < left_cost && cost < right_cost) {
+        break;
+      }
+
+      sibling = left_cost < right_cost ? n->left : n->right;
+    }
+
+    U32 new_parent = allocate_scene_node(context);
+    if (new_parent) {
+      Scene_Node *s = Get_Scene_Node(na, sibling);
+      Scene_Node *np = Get_Scene_Node(na, new_parent);
+      U32 old_parent = s->parent;
+
+      np->parent = old_parent;
+      np->box = get_rectangle_union(leaf_box, s->box);
+      np->height = s->height + 1;
+      np->left = sibling;
+      np->right = leaf;
+      replace_scene_child(context, old_parent, sibling, new_parent);
+
+      s->parent = new_parent;
+      Get_Scene_Node(na, leaf)->parent = new_parent;
+
+      refit_scene_ancestors(context, new_parent);
+    }
+  }
+}
+
+
+function void remove_scene_leaf(Context *context, U32 leaf) {
+  arena *na = &context->scene_arena;
+
+  if (leaf == context->scene_root) {
+    context->scene_root = 0;
+  } else {
+    U32 parent = Get_Scene_Node(na, leaf)->parent;
+    Scene_Node *p = Get_Scene_Node(na, parent);
+    U32 grandparent = p->parent;
+    U32 sibling = p->left == leaf ? p->right : p->left;
+
+    replace_scene_child(context, grandparent, parent, sibling);
+    Get_Scene_Node(na, sibling)->parent = grandparent;
+    free_scene_node(context, parent);
+
+    refit_scene_ancestors(context, grandparent);
+  }
+
+  free_scene_node(context, leaf);
+}
+
+
+/*
+  Make sure *leaf covers bounds. A leaf whose fat box still contains the bounds is left alone, otherwise it is re-inserted with a new fat box.
+*/
+function void update_scene_leaf(Context *context, U32 *leaf, Rectangle bounds, U32 item) {
+  arena *na = &context->scene_arena;
+  B32 is_covered = *leaf && rectangle_contains_rectangle(Get_Scene_Node(na, *leaf)->box, bounds);
+
+  if (!is_covered) {
+    if (*leaf) {
+      remove_scene_leaf(context, *leaf);
+    }
+
+    *leaf = allocate_scene_node(context);
+    if (*leaf) {
+      Scene_Node *n = Get_Scene_Node(na, *leaf);
+      n->box = (Rectangle){bounds.x - Scene_Fat_Margin, bounds.y - Scene_Fat_Margin,
+                           bounds.width + 2.0f*Scene_Fat_Margin, bounds.height + 2.0f*Scene_Fat_Margin};
+      n->item = item;
+      insert_scene_leaf(context, *leaf);
+    }
+  }
+}
+
+
+function void remove_process_from_scene(Context *context, U32 process_index) {
+  Process_Shape_Cache *cache = Get_Process_Shape_Cache(&context->shape_arena, process_index);
+
+  if (cache->scene_leaf) {
+    remove_scene_leaf(context, cache->scene_leaf);
+    cache->scene_leaf = 0;
+  }
+}
+
+
+/*
+  Queue a process to be (re)inserted into the grid and the scene-tree, because it was created, moved or its shape changed. Its wires are refit along with it. The queue is flushed by update_spatial_indices before either index is queried.
+*/
+function void mark_process_spatial_dirty(Context *context, Process *p) {
+  arena *pa = &context->process_arena;
+  U32 index = Get_Process_Index(pa, p);
+
+  if (index && !Get_Flag(p->flags, Process_Flag_SpatialDirty)) {
+    U32 *entry = ryn_memory_PushStruct(&context->spatial_dirty_arena, U32);
+    if (entry) {
+      *entry = index;
+      Set_Flag(p->flags, Process_Flag_SpatialDirty);
+    }
+  }
+}
+
+
+/*
+  Empty the grid and the scene-tree, and queue every live process to be inserted again.
+*/
+function void rebuild_spatial_indices(Context *context) {
+  arena *pa = &context->process_arena;
+  arena *wa = &context->wire_arena;
+  arena *ga = &context->grid_arena;
+  S32 pc = Get_Process_Count(pa);
+  S32 wc = Get_Wire_Count(wa);
+
+  ga->Offset = Grid_Bucket_Count*sizeof(U32) + sizeof(Grid_Node);
+  for (S32 i = 0; i < Grid_Bucket_Count; ++i) {
+    Get_Grid_Buckets(ga)[i] = 0;
+  }
+  context->first_free_grid_node = 0;
+  context->spatial_dirty_arena.Offset = 0;
+
+  context->scene_arena.Offset = sizeof(Scene_Node);
+  context->scene_root = 0;
+  context->first_free_scene_node = 0;
+  for (S32 i = 1; i <= wc; ++i) {
+    Get_Wire_Slot(wa, i)->scene_leaf = 0;
+  }
+
+  for (S32 i = 1; i <= pc; ++i) {
+    Process *p = Get_Process_Slot(pa, i);
+    Get_Process_Shape_Cache(&context->shape_arena, i)->in_grid = 0;
+    Get_Process_Shape_Cache(&context->shape_arena, i)->scene_leaf = 0;
+    Unset_Flag(p->flags, Process_Flag_SpatialDirty);
+
+    if (!Get_Flag(p->flags, Process_Flag_Deleted)) {
+      mark_process_spatial_dirty(context, p);
+    }
+  }
+}
+
+
+
+
+function Process *create_process(Context *context) {
+  arena *pa = &context->process_arena;
+  Process *p = 0;
+
+  if (context->first_free_process_index) {
+    // pop from the free-list
+    p = Get_Process_Slot(pa, context->first_free_process_index);
+    Assert(Get_Flag(p->flags, Process_Flag_Deleted));
+    context->first_free_process_index = p->next_free_index;
+    context->free_process_count -= 1;
+
+    U32 generation = p->generation;
+    *p = (Process){0};
+    p->generation = generation;
+  } else {
+    p = ryn_memory_PushZeroStruct(pa, Process);
+    if (p) {
+      p->generation = context->process_generation_floor;
+    }
+
+    // NOTE: Keep the shape-cache the same length as the process table. Only the epoch needs clearing, the rest of the entry is written when it is first built.
+    Process_Shape_Cache *cache = 0;
+    if (p) {
+      cache = ryn_memory_PushStruct(&context->shape_arena, Process_Shape_Cache);
+    }
+
+    if (cache) {
+      cache->epoch = 0;
+      cache->ports = 0;
+      cache->in_grid = 0;
+      cache->scene_leaf = 0;
+    } else if (p) {
+      pa->Offset -= sizeof(Process);
+      p = 0;
+    }
+  }
+
+  if (p) {
+    mark_process_spatial_dirty(context, p);
+  }
+
+  return p;
+}
+
+
+/*
+  Move a process, keeping the spatial grid up to date. Positions written right after create_process are picked up as well, since new processes are already queued for the grid.
+*/
+function void set_process_position(Context *context, Process *p, Vector2 position) {
+  p->position = position;
+  mark_process_spatial_dirty(context, p);
+}
+
+
+
+function void free_process(Context *context, Process *p) {
+  arena *pa = &context->process_arena;
+  U32 index = Get_Process_Index(pa, p);
+
+  free_wire_list(context, p->in_wires);
+  free_wire_list(context, p->out_wires);
+  free_label(context, p->label);
+  remove_process_from_grid(context, index);
+  remove_process_from_scene(context, index);
+
+  // NOTE: Bumping the generation invalidates every id that still refers to this process.
+  U32 generation = p->generation + 1;
+  *p = (Process){0};
+  p->generation = generation;
+  Set_Flag(p->flags, Process_Flag_Deleted);
+
+  // push onto the free-list
+  p->next_free_index = context->first_free_process_index;
+  context->first_free_process_index = index;
+  context->free_process_count += 1;
+}
+
+
+
+
+function Wire *create_wire(Context *context) {
+  arena *wa = &context->wire_arena;
+  Wire *wire = 0;
+
+  if (context->first_free_wire_index) {
+    // pop from the free-list
+    wire = Get_Wire_Slot(wa, context->first_free_wire_index);
+    Assert(Wire_Is_Deleted(wire));
+    context->first_free_wire_index = (U32)wire->in_id;
+    context->free_wire_count -= 1;
+
+    U32 generation = wire->generation;
+    *wire = (Wire){0};
+    wire->generation = generation;
+  } else {
+    wire = ryn_memory_PushZeroStruct(wa, Wire);
+    if (wire) {
+      wire->generation = context->wire_generation_floor;
+    }
+
+    // NOTE: Keep the curve-cache the same length as the wire table. Only the polyline needs clearing, the rest of the entry is written when the wire is first fit into the scene-tree.
+    Wire_Curve_Cache *curve_cache = 0;
+    if (wire) {
+      curve_cache = ryn_memory_PushStruct(&context->wire_curve_arena, Wire_Curve_Cache);
+    }
+
+    if (curve_cache) {
+      curve_cache->points = 0;
+      curve_cache->point_count = 0;
+    } else if (wire) {
+      wa->Offset -= sizeof(Wire);
+      wire = 0;
+    }
+  }
+
+  return wire;
+}
+
+
+
+function void free_wire(Context *context, Wire *wire) {
+  arena *wa = &context->wire_arena;
+  U32 index = Get_Wire_Index(wa, wire);
+
+  if (wire->scene_leaf) {
+    remove_scene_leaf(context, wire->scene_leaf);
+  }
+
+  // NOTE: Bumping the generation invalidates every id that still refers to this wire.
+  U32 generation = wire->generation + 1;
+  *wire = (Wire){0};
+  wire->generation = generation;
+
+  // push onto the free-list
+  wire->in_id = context->first_free_wire_index;
+  context->first_free_wire_index = index;
+  context->free_wire_count += 1;
+}
+
+
+
+
+/*
+  Remove wires that are marked for deletion from a process' wire-lists, renumbering the remaining wires in a single pass over each list.
+*/
+function void compact_wire_lists(Context *context, Process *p) {
+  arena *wa = &context->wire_arena;
+  arena *ea = &context->edge_arena;
+
+  Wire_Id *in_list = Get_Wire_List(ea, p->in_wires);
+  S32 in_count = 0;
+  for (S32 i = 0; i < p->in_count; ++i) {
+    Wire *wire = Get_Wire_By_Id(wa, in_list[i]);
+    if (wire->which_in != Wire_Marked) {
+      in_list[in_count] = in_list[i];
+      wire->which_in = in_count;
+      in_count += 1;
+    }
+  }
+  p->in_count = in_count;
+
+  Wire_Id *out_list = Get_Wire_List(ea, p->out_wires);
+  S32 out_count = 0;
+  for (S32 i = 0; i < p->out_count; ++i) {
+    Wire *wire = Get_Wire_By_Id(wa, out_list[i]);
+    if (wire->which_in != Wire_Marked) {
+      out_list[out_count] = out_list[i];
+      wire->which_out = out_count;
+      out_count += 1;
+    }
+  }
+  p->out_count = out_count;
+}
+
+
+
+/*
+  Delete a batch of processes and wires. Wires attached to deleted processes are deleted too.
+
+  The cost is proportional to the number of deleted processes plus the wires attached to them; surviving processes that lose wires get their wire-lists compacted once, no matter how many of their wires are deleted.
+
+  An invisible process that loses its last wire, and has no label, is deleted as well, since there would be no way to see or select it anymore.
+*/
+function void delete_processes(Context *context, Process_Id *process_ids, S32 process_count, Wire_Id *wire_ids, S32 wire_count) {
+  arena *pa = &context->process_arena;
+  arena *wa = &context->wire_arena;
+  arena *ea = &context->edge_arena;
+  arena *la = &context->label_arena;
+  arena *ta = &context->temp_arena;
+  ryn_memory_BeginArena(ta);
+
+  // NOTE: Every deleted id lands in one of these lists at most once, so they can't overflow.
+  Process_Id *deleted_processes = ryn_memory_PushAlignedArray(ta, Process_Id, Get_Process_Count(pa));
+  Wire_Id *deleted_wires = ryn_memory_PushAlignedArray(ta, Wire_Id, Get_Wire_Count(wa));
+  S32 deleted_process_count = 0;
+  S32 deleted_wire_count = 0;
+
+  if (deleted_processes && deleted_wires) {
+    // mark the requested processes
+    for (S32 i = 0; i < process_count; ++i) {
+      Process *p = Get_Process_By_Id(pa, process_ids[i]);
+      B32 skip = (!Process_Id_Is_Valid(pa, process_ids[i]) ||
+                  Get_Flag(p->flags, Process_Flag_Marked));
+
+      if (!skip) {
+        Set_Flag(p->flags, Process_Flag_Marked);
+        deleted_processes[deleted_process_count++] = process_ids[i];
+      }
+    }
+
+    // mark the requested wires
+    for (S32 i = 0; i < wire_count; ++i) {
+      Wire *wire = Get_Wire_By_Id(wa, wire_ids[i]);
+      B32 skip = (!Wire_Id_Is_Valid(wa, wire_ids[i]) ||
+                  wire->which_in == Wire_Marked);
+
+      if (!skip) {
+        wire->which_in = Wire_Marked;
+        deleted_wires[deleted_wire_count++] = wire_ids[i];
+      }
+    }
+
+    // mark wires attached to marked processes
+    for (S32 i = 0; i < deleted_process_count; ++i) {
+      Process *p = Get_Process_By_Id(pa, deleted_processes[i]);
+
+      Wire_Id *in_list = Get_Wire_List(ea, p->in_wires);
+      for (S32 j = 0; j < p->in_count; ++j) {
+        Wire *wire = Get_Wire_By_Id(wa, in_list[j]);
+        if (wire->which_in != Wire_Marked) {
+          wire->which_in = Wire_Marked;
+          deleted_wires[deleted_wire_count++] = in_list[j];
+        }
+      }
+
+      Wire_Id *out_list = Get_Wire_List(ea, p->out_wires);
+      for (S32 j = 0; j < p->out_count; ++j) {
+        Wire *wire = Get_Wire_By_Id(wa, out_list[j]);
+        if (wire->which_in != Wire_Marked) {
+          wire->which_in = Wire_Marked;
+          deleted_wires[deleted_wire_count++] = out_list[j];
+        }
+      }
+    }
+
+    // compact the wire-lists of surviving processes that lose wires
+    for (S32 i = 0; i < deleted_wire_count; ++i) {
+      Wire *wire = Get_Wire_By_Id(wa, deleted_wires[i]);
+      Process *ends[2] = {
+        Get_Process_By_Id(pa, wire->in_id),
+        Get_Process_By_Id(pa, wire->out_id),
+      };
+
+      for (S32 j = 0; j < 2; ++j) {
+        Process *end = ends[j];
+        if (!Get_Flag(end->flags, Process_Flag_Marked|Process_Flag_Touched)) {
+          Set_Flag(end->flags, Process_Flag_Touched);
+          compact_wire_lists(context, end);
+        }
+      }
+    }
+
+    // free the wires, and clean up processes that became invisible orphans
+    for (S32 i = 0; i < deleted_wire_count; ++i) {
+      Wire *wire = Get_Wire_By_Id(wa, deleted_wires[i]);
+      Process *ends[2] = {
+        Get_Process_By_Id(pa, wire->in_id),
+        Get_Process_By_Id(pa, wire->out_id),
+      };
+
+      for (S32 j = 0; j < 2; ++j) {
+        Process *end = ends[j];
+        if (Get_Flag(end->flags, Process_Flag_Touched)) {
+          Unset_Flag(end->flags, Process_Flag_Touched);
+
+          B32 is_orphan = (Get_Flag(end->flags, Process_Flag_Empty) &&
+                           end->in_count == 0 && end->out_count == 0 &&
+                           Get_Label_Size(la, end->label) == 0);
+          if (is_orphan) {
+            free_process(context, end);
+          } else {
+            mark_process_spatial_dirty(context, end);
+          }
+        }
+      }
+
+      free_wire(context, wire);
+    }
+
+    // free the processes
+    for (S32 i = 0; i < deleted_process_count; ++i) {
+      free_process(context, Get_Process_By_Id(pa, deleted_processes[i]));
+    }
+  }
+
+  context->active_id = 0;
+  context->active_wire_id = 0;
+
+  ryn_memory_EndArena(ta);
+}
+
+
+
+function void delete_process(Context *context, Process *p) {
+  arena *pa = &context->process_arena;
+  Process_Id id = Get_Process_Id(pa, p);
+  delete_processes(context, &id, 1, 0, 0);
+}
+
+
+function void delete_wire(Context *context, Wire *wire) {
+  arena *wa = &context->wire_arena;
+  Wire_Id id = Get_Wire_Id(wa, wire);
+  delete_processes(context, 0, 0, &id, 1);
+}
+
+
+
+function void connect_processes(Context *context, Process *out, Process *in) {
+  arena *pa = &context->process_arena;
+  arena *wa = &context->wire_arena;
+  Wire *new_wire = create_wire(context);
+
+  if (new_wire) {
+    Process_Id out_id = Get_Process_Id(pa, out);
+    Process_Id in_id = Get_Process_Id(pa, in);
+    Wire_Id wire_id = Get_Wire_Id(wa, new_wire);
+
+    B32 pushed = (push_wire_list(context, &out->out_wires, out->out_count, wire_id) &&
+                  push_wire_list(context, &in->in_wires, in->in_count, wire_id));
+
+    if (pushed) {
+      new_wire->out_id = out_id;
+      new_wire->in_id = in_id;
+
+      new_wire->which_out = out->out_count;
+      new_wire->which_in = in->in_count;
+
+      out->out_count += 1;
+      in->in_count += 1;
+
+      mark_process_spatial_dirty(context, out);
+      mark_process_spatial_dirty(context, in);
+    } else {
+      free_wire(context, new_wire);
+    }
+  }
+}
+
+
+
+
+
+#define Build_Process_Flags (Process_Flag_Empty|Process_Flag_Cup|Process_Flag_Cap)
+
+/*
+  Builds a whole diagram at once, for generated diagrams that would be too slow to build one connect_processes at a time.
+
+  The descriptions are validated before anything is created, so a bad edge or flag leaves the context untouched. Degrees are counted up front, so every wire-list is allocated once at its final size and wires are appended without scanning. The new ids are written to process_ids if it is non-null.
+*/
+function B32 build_diagram(Context *context, Process_Desc *processes, S32 process_count, Wire_Desc *wires, S32 wire_count, Process_Id *process_ids) {
+  arena *pa = &context->process_arena;
+  arena *wa = &context->wire_arena;
+  arena *ea = &context->edge_arena;
+  arena *la = &context->label_arena;
+  arena *ta = &context->temp_arena;
+  ryn_memory_BeginArena(ta);
+
+  B32 is_valid = process_count >= 0 && wire_count >= 0;
+  for (S32 i = 0; is_valid && i < process_count; ++i) {
+    is_valid = (processes[i].flags & ~Build_Process_Flags) == 0;
+  }
+  for (S32 i = 0; is_valid && i < wire_count; ++i) {
+    is_valid = (wires[i].out_process < (U32)process_count &&
+                wires[i].in_process < (U32)process_count);
+  }
+
+  Process **new_processes = 0;
+  if (is_valid) {
+    new_processes = ryn_memory_PushAlignedArray(ta, Process *, process_count);
+    is_valid = (process_count == 0) || new_processes;
+  }
+
+  B32 built = 0;
+  if (is_valid) {
+    S32 created_count = 0;
+    B32 failed = 0;
+
+    for (S32 i = 0; !failed && i < process_count; ++i) {
+      Process *p = create_process(context);
+      failed = !p;
+
+      if (!failed) {
+        new_processes[created_count++] = p;
+        p->position = processes[i].position;
+        Set_Flag(p->flags, processes[i].flags);
+
+        const char *text = processes[i].label;
+        U32 size = 0;
+        while (text && text[size]) {
+          size += 1;
+        }
+        if (size) {
+          p->label = allocate_label(context, size+1);
+          failed = !p->label;
+
+          if (p->label) {
+            char *label_text = Get_Label_Text(la, p->label);
+            for (U32 j = 0; j <= size; ++j) {
+              label_text[j] = text[j];
+            }
+            Get_Label_Header(la, p->label)->size = size;
+          }
+        }
+      }
+    }
+
+    // count the degrees, then allocate every wire-list at its final size
+    if (!failed) {
+      for (S32 i = 0; i < wire_count; ++i) {
+        new_processes[wires[i].out_process]->out_count += 1;
+        new_processes[wires[i].in_process]->in_count += 1;
+      }
+
+      for (S32 i = 0; i < process_count; ++i) {
+        Process *p = new_processes[i];
+
+        if (!failed && p->in_count) {
+          p->in_wires = allocate_wire_list(context, p->in_count);
+          failed = !p->in_wires;
+        }
+        if (!failed && p->out_count) {
+          p->out_wires = allocate_wire_list(context, p->out_count);
+          failed = !p->out_wires;
+        }
+
+        p->in_count = 0;
+        p->out_count = 0;
+      }
+    }
+
+    // append the wires, in port order
+    for (S32 i = 0; !failed && i < wire_count; ++i) {
+      Wire *wire = create_wire(context);
+      failed = !wire;
+
+      if (!failed) {
+        Process *out = new_processes[wires[i].out_process];
+        Process *in = new_processes[wires[i].in_process];
+        Wire_Id wire_id = Get_Wire_Id(wa, wire);
+
+        wire->out_id = Get_Process_Id(pa, out);
+        wire->in_id = Get_Process_Id(pa, in);
+        wire->which_out = out->out_count;
+        wire->which_in = in->in_count;
+
+        Get_Wire_List(ea, out->out_wires)[out->out_count++] = wire_id;
+        Get_Wire_List(ea, in->in_wires)[in->in_count++] = wire_id;
+      }
+    }
+
+    if (failed) {
+      // NOTE: Ran out of memory part way through, undo everything so the caller never sees half a diagram.
+      Process_Id *created_ids = ryn_memory_PushAlignedArray(ta, Process_Id, created_count);
+      if (created_ids) {
+        for (S32 i = 0; i < created_count; ++i) {
+          created_ids[i] = Get_Process_Id(pa, new_processes[i]);
+        }
+        delete_processes(context, created_ids, created_count, 0, 0);
+      }
+    } else {
+      if (process_ids) {
+        for (S32 i = 0; i < process_count; ++i) {
+          process_ids[i] = Get_Process_Id(pa, new_processes[i]);
+        }
+      }
+      built = 1;
+    }
+  }
+
+  ryn_memory_EndArena(ta);
+  return built;
+}
+
+
+
+#define Compact_Min_Free_Count 1024
+
+/*
+  Slides live processes and wires to the front of their tables, so the per-frame loops only visit live elements, and remaps every wire end, wire-list entry and hot/active id in one linear pass. The free-lists end up empty.
+
+  A moved element gets a generation newer than any id that referred to either of its slots. The slots past the new end are dropped, but the generation floor is raised past all of theirs, so a slot pushed there later starts newer than any id that referred to it. Either way stale ids still fail to validate. Ids held outside of the context are not remapped and should be dropped before compacting.
+*/
+function void compact_context(Context *context) {
+  arena *pa = &context->process_arena;
+  arena *wa = &context->wire_arena;
+  arena *ea = &context->edge_arena;
+  arena *sa = &context->shape_arena;
+  arena *ta = &context->temp_arena;
+  ryn_memory_BeginArena(ta);
+
+  S32 pc = Get_Process_Count(pa);
+  S32 wc = Get_Wire_Count(wa);
+
+  // NOTE: Map old slot index to new slot index, zero for deleted slots.
+  U32 *process_remap = ryn_memory_PushAlignedArray(ta, U32, pc+1);
+  U32 *wire_remap = ryn_memory_PushAlignedArray(ta, U32, wc+1);
+
+  if (process_remap && wire_remap) {
+    U32 hot_index = Process_Id_Is_Valid(pa, context->hot_id) ? Id_Index(context->hot_id) : 0;
+    U32 active_index = Process_Id_Is_Valid(pa, context->active_id) ? Id_Index(context->active_id) : 0;
+    U32 hot_wire_index = Wire_Id_Is_Valid(wa, context->hot_wire_id) ? Id_Index(context->hot_wire_id) : 0;
+    U32 active_wire_index = Wire_Id_Is_Valid(wa, context->active_wire_id) ? Id_Index(context->active_wire_id) : 0;
+
+    // slide processes
+    U32 process_count = 0;
+    process_remap[0] = 0;
+    for (S32 i = 1; i <= pc; ++i) {
+      Process *p = Get_Process_Slot(pa, i);
+      process_remap[i] = 0;
+
+      if (!Get_Flag(p->flags, Process_Flag_Deleted)) {
+        process_count += 1;
+        process_remap[i] = process_count;
+
+        if (process_count != (U32)i) {
+          Process *to = Get_Process_Slot(pa, process_count);
+          U32 generation = 1 + (to->generation > p->generation ? to->generation : p->generation);
+          *to = *p;
+          to->generation = generation;
+
+          // NOTE: The moved entry takes its port-list along, the one it replaces is freed.
+          Process_Shape_Cache *from_cache = Get_Process_Shape_Cache(sa, i);
+          Process_Shape_Cache *to_cache = Get_Process_Shape_Cache(sa, process_count);
+          free_port_list(context, to_cache->ports);
+          *to_cache = *from_cache;
+          from_cache->ports = 0;
+          from_cache->epoch = 0;
+        }
+      }
+    }
+
+    // slide wires, remapping their ends
+    U32 wire_count = 0;
+    wire_remap[0] = 0;
+    for (S32 i = 1; i <= wc; ++i) {
+      Wire *w = Get_Wire_Slot(wa, i);
+      wire_remap[i] = 0;
+
+      if (!Wire_Is_Deleted(w)) {
+        wire_count += 1;
+        wire_remap[i] = wire_count;
+
+        Process *out = Get_Process_Slot(pa, process_remap[Id_Index(w->out_id)]);
+        Process *in = Get_Process_Slot(pa, process_remap[Id_Index(w->in_id)]);
+        w->out_id = Make_Id(process_remap[Id_Index(w->out_id)], out->generation);
+        w->in_id = Make_Id(process_remap[Id_Index(w->in_id)], in->generation);
+
+        if (wire_count != (U32)i) {
+          Wire *to = Get_Wire_Slot(wa, wire_count);
+          U32 generation = 1 + (to->generation > w->generation ? to->generation : w->generation);
+          *to = *w;
+          to->generation = generation;
+        }
+      }
+    }
+
+    for (S32 i = process_count+1; i <= pc; ++i) {
+      U32 generation = Get_Process_Slot(pa, i)->generation + 1;
+      context->process_generation_floor = Max(context->process_generation_floor, generation);
+      free_port_list(context, Get_Process_Shape_Cache(sa, i)->ports);
+    }
+    for (S32 i = wire_count+1; i <= wc; ++i) {
+      U32 generation = Get_Wire_Slot(wa, i)->generation + 1;
+      context->wire_generation_floor = Max(context->wire_generation_floor, generation);
+      free_port_list(context, Get_Wire_Curve_Cache(&context->wire_curve_arena, i)->points);
+    }
+
+    pa->Offset = (process_count+1)*sizeof(Process);
+    sa->Offset = (process_count+1)*sizeof(Process_Shape_Cache);
+    wa->Offset = (wire_count+1)*sizeof(Wire);
+    // NOTE: The curve-caches are not moved along with the wires, rebuild_spatial_indices below refits every wire. The polylines stay with their slots and are reused.
+    context->wire_curve_arena.Offset = (wire_count+1)*sizeof(Wire_Curve_Cache);
+    context->first_free_process_index = 0;
+    context->first_free_wire_index = 0;
+    context->free_process_count = 0;
+    context->free_wire_count = 0;
+    rebuild_spatial_indices(context);
+
+    // remap the wire-lists
+    for (U32 i = 1; i <= process_count; ++i) {
+      Process *p = Get_Process_Slot(pa, i);
+
+      Wire_Id *in_list = Get_Wire_List(ea, p->in_wires);
+      for (S32 j = 0; j < p->in_count; ++j) {
+        U32 index = wire_remap[Id_Index(in_list[j])];
+        in_list[j] = Make_Id(index, Get_Wire_Slot(wa, index)->generation);
+      }
+
+      Wire_Id *out_list = Get_Wire_List(ea, p->out_wires);
+      for (S32 j = 0; j < p->out_count; ++j) {
+        U32 index = wire_remap[Id_Index(out_list[j])];
+        out_list[j] = Make_Id(index, Get_Wire_Slot(wa, index)->generation);
+      }
+    }
+
+    // remap the hot/active ids
+    hot_index = process_remap[hot_index];
+    active_index = process_remap[active_index];
+    hot_wire_index = wire_remap[hot_wire_index];
+    active_wire_index = wire_remap[active_wire_index];
+    context->hot_id = hot_index ? Make_Id(hot_index, Get_Process_Slot(pa, hot_index)->generation) : 0;
+    context->active_id = active_index ? Make_Id(active_index, Get_Process_Slot(pa, active_index)->generation) : 0;
+    context->hot_wire_id = hot_wire_index ? Make_Id(hot_wire_index, Get_Wire_Slot(wa, hot_wire_index)->generation) : 0;
+    context->active_wire_id = active_wire_index ? Make_Id(active_wire_index, Get_Wire_Slot(wa, active_wire_index)->generation) : 0;
+  }
+
+  ryn_memory_EndArena(ta);
+}
+
+
+/*
+  Compaction is worth it once the tables are at least half holes.
+*/
+function B32 should_compact_context(Context *context) {
+  U32 process_slots = Get_Process_Count(&context->process_arena);
+  U32 wire_slots = Get_Wire_Count(&context->wire_arena);
+
+  B32 should_compact = ((context->free_process_count >= Compact_Min_Free_Count &&
+                         2*context->free_process_count >= process_slots) ||
+                        (context->free_wire_count >= Compact_Min_Free_Count &&
+                         2*context->free_wire_count >= wire_slots));
+  return should_compact;
+}
+
+function void
+fill_out_half_circle_shape(Context *context, Process_Shape *shape, Process *p, Vector2 position, B32 downward) {
+  F32 padding = global_process_wire_padding;
+  F32 spacing = global_process_wire_spacing;
+
+  F32 conn_count = (F32)(downward ? p->out_count : p->in_count);
+  F32 width = (2.0f*padding + conn_count*spacing);
+  F32 half_width = 0.5f*(width);
+
+  F32 height = global_shape_size;
+  F32 half_height = global_shape_half_size;
+  shape->kind = Process_Shape_HalfCircle;
+  shape->triangle_count = global_shape_fan_triangle_count;
+  shape->downward = downward;
+
+  F32 multiplier = downward ? -1.0f : 1.0f;
+  F32 x_offset = multiplier * half_width;
+  F32 y_offset = multiplier * half_height;
+
+  Vector2 first_point = (Vector2){position.x-x_offset, position.y+y_offset};
+  Vector2 second_point = (Vector2){position.x+x_offset, position.y+y_offset};
+  shape->first_control = (Vector2){first_point.x, first_point.y-2.0f*y_offset};
+  shape->second_control = (Vector2){second_point.x, second_point.y-2.0f*y_offset};
+
+  Vector2 middle_of_curve = get_bezier_point(
+    first_point, second_point,
+    shape->first_control, shape->second_control,
+    0.5f);
+  Vector2 middle_of_line = get_percentage_between_points(first_point, second_point, 0.5f);
+  shape->center = get_percentage_between_points(middle_of_curve, middle_of_line, 0.5);
+
+  shape->point_count = create_bezier_triangle_fan(
+    first_point, second_point,
+    shape->first_control, shape->second_control,
+    shape->points, Process_Shape_Max_Points, shape->triangle_count);
+}
+
+
+
+/*
+  Split the shape's points into triangles and an outline. Triangles and quadrangles are triangle-strips, and half-circles and circles are triangle-fans around points[0].
+*/
+function void
+fill_out_process_shape_mesh(Process_Shape *shape) {
+  shape->triangle_count = 0;
+  shape->outline_count = 0;
+  shape->min = shape->points[0];
+  shape->max = shape->points[0];
+  for (S32 i = 1; i < shape->point_count; ++i) {
+    shape->min = Vector2Min(shape->min, shape->points[i]);
+    shape->max = Vector2Max(shape->max, shape->points[i]);
+  }
+
+  switch(shape->kind) {
+  case Process_Shape_Triangle:
+  case Process_Shape_Quadrangle:
+  case Process_Shape_Rectangle: {
+    // NOTE: The second triangle of a strip winds the other way, so its first two points are swapped.
+    for (S32 i = 0; i + 2 < shape->point_count; ++i) {
+      U8 *triangle = shape->triangles[shape->triangle_count++];
+      triangle[0] = (U8)(i & 1 ? i+1 : i);
+      triangle[1] = (U8)(i & 1 ? i : i+1);
+      triangle[2] = (U8)(i+2);
+    }
+
+    // NOTE: Walk the even points forward and the odd points back, which goes around the strip.
+    for (S32 i = 0; i < shape->point_count; i += 2) {
+      shape->outline[shape->outline_count++] = (U8)i;
+    }
+    for (S32 i = shape->point_count - (shape->point_count & 1 ? 2 : 1); i > 0; i -= 2) {
+      shape->outline[shape->outline_count++] = (U8)i;
+    }
+  } break;
+  case Process_Shape_Circle:
+  case Process_Shape_HalfCircle: {
+    B32 closed = shape->kind == Process_Shape_Circle;
+    S32 rim_count = shape->point_count - 1;
+
+    for (S32 i = 1; i < rim_count + closed; ++i) {
+      U8 *triangle = shape->triangles[shape->triangle_count++];
+      triangle[0] = 0;
+      triangle[1] = (U8)i;
+      triangle[2] = (U8)(i % rim_count + 1);
+    }
+
+    // NOTE: The hub of a half-circle is a corner of its flat edge, so it is on the outline. The center of a circle is not.
+    for (S32 i = closed; i < shape->point_count; ++i) {
+      shape->outline[shape->outline_count++] = (U8)i;
+    }
+  } break;
+  }
+}
+
+
+
+function Process_Shape
+build_process_shape(Context *context, Process *p, Vector2 position) {
+  Process_Shape shape = {0};
+
+  F32 quarter_size = global_shape_size / 4.0f;
+  F32 padding = global_process_wire_padding;
+  F32 spacing = global_process_wire_spacing;
+
+  S32 has_in = p->in_count > 0;
+  S32 has_out = p->out_count > 0;
+
+  B32 rounded = Get_Flag(context->flags, Context_Flag_RoundedShapes);
+
+  if (has_in && has_out) {
+    // rectangular
+    F32 max_conn = (F32)Max(p->in_count, p->out_count);
+    F32 half_width = 0.5f*(2.0f*padding + max_conn*spacing);
+    shape.kind = Process_Shape_Rectangle;
+    shape.point_count = 4;
+    shape.points[0].x = position.x + half_width;
+    shape.points[0].y = position.y - global_shape_half_size;
+    shape.points[1].x = position.x - half_width;
+    shape.points[1].y = position.y - global_shape_half_size;
+    shape.points[2].x = position.x + half_width;
+    shape.points[2].y = position.y + global_shape_half_size;
+    shape.points[3].x = position.x - half_width;
+    shape.points[3].y = position.y + global_shape_half_size;
+    shape.center = get_percentage_between_points(shape.points[0], shape.points[3], 0.5f);
+  } else if (has_in) {
+    F32 width = (2.0f*padding + p->in_count*spacing);
+    F32 half_width = 0.5f*(width);
+    if (rounded) {
+      // upward half-circle
+      fill_out_half_circle_shape(context, &shape, p, position, 0);
+    } else {
+      // upward triangle
+      shape.kind = Process_Shape_Triangle;
+      shape.point_count = 3;
+      shape.points[0].x = position.x;
+      shape.points[0].y = position.y - quarter_size;
+      shape.points[1].x = position.x - half_width;
+      shape.points[1].y = position.y + global_shape_half_size;
+      shape.points[2].x = position.x + half_width;
+      shape.points[2].y = position.y + global_shape_half_size;
+      Vector2 outer_mid = get_percentage_between_points(shape.points[1], shape.points[2], 0.5f);
+      shape.center = get_percentage_between_points(shape.points[0], outer_mid, 0.66f);
+    }
+  } else if (has_out) {
+    F32 width = (2.0f*padding + p->out_count*spacing);
+    F32 half_width = 0.5f*(width);
+    if (rounded) {
+      // downward half-circle
+      fill_out_half_circle_shape(context, &shape, p, position, 1);
+    } else {
+      // downward triangle
+      shape.kind = Process_Shape_Triangle;
+      shape.point_count = 3;
+      shape.points[0].x = position.x + half_width;
+      shape.points[0].y = position.y - global_shape_half_size;
+      shape.points[1].x = position.x - half_width;
+      shape.points[1].y = position.y - global_shape_half_size;
+      shape.points[2].x = position.x;
+      shape.points[2].y = position.y + quarter_size;
+      Vector2 outer_mid = get_percentage_between_points(shape.points[0], shape.points[1], 0.5f);
+      shape.center = get_percentage_between_points(shape.points[2], outer_mid, 0.66f);
+    }
+  } else {
+    if (rounded) {
+      // circle
+      shape.kind = Process_Shape_Circle;
+      shape.center = position;
+      shape.radius = global_shape_half_size*0.7f;
+      // NOTE: The center is the hub of the fan, and the rim walks clockwise so the triangles wind the same way as every other shape.
+      shape.point_count = Circle_Segment_Count + 1;
+      shape.points[0] = position;
+      for (S32 i = 0; i < Circle_Segment_Count; ++i) {
+        F32 angle = -2.0f*PI*(F32)i / (F32)Circle_Segment_Count;
+        shape.points[i+1].x = position.x + shape.radius*cosf(angle);
+        shape.points[i+1].y = position.y + shape.radius*sinf(angle);
+      }
+    } else {
+      // diamond
+      shape.kind = Process_Shape_Quadrangle;
+      shape.point_count = 4;
+      shape.points[0].x = position.x;
+      shape.points[0].y = position.y - global_shape_half_size;
+      shape.points[1].x = position.x - global_shape_half_size;
+      shape.points[1].y = position.y;
+      shape.points[2].x = position.x + global_shape_half_size;
+      shape.points[2].y = position.y;
+      shape.points[3].x = position.x;
+      shape.points[3].y = position.y + global_shape_half_size;
+      shape.center = get_percentage_between_points(shape.points[0], shape.points[3], 0.5f);
+    }
+  }
+
+  fill_out_process_shape_mesh(&shape);
+
+  return shape;
+}
+
+
+
+/*
+  Get the shape of a process, rebuilding its cache entry only if the process moved, changed its wire counts or flags, or the shapes were invalidated since the entry was built.
+*/
+function Process_Shape *get_process_shape(Context *context, Process *p) {
+  arena *pa = &context->process_arena;
+  arena *sa = &context->shape_arena;
+  Process_Shape_Cache *cache = Get_Process_Shape_Cache(sa, Get_Process_Index(pa, p));
+
+  Vector2 position = get_process_position(context, p);
+  U32 flags = p->flags & Process_Shape_Flags;
+  B32 is_stale = (cache->epoch != context->shape_epoch ||
+                  cache->position.x != position.x || cache->position.y != position.y ||
+                  cache->in_count != p->in_count || cache->out_count != p->out_count ||
+                  cache->flags != flags);
+
+  if (is_stale) {
+    cache->position = position;
+    cache->in_count = p->in_count;
+    cache->out_count = p->out_count;
+    cache->flags = flags;
+    cache->epoch = context->shape_epoch;
+    cache->shape = build_process_shape(context, p, position);
+
+    U32 port_count = p->in_count + p->out_count;
+    if (port_count > Get_Port_List_Capacity(&context->port_arena, cache->ports)) {
+      free_port_list(context, cache->ports);
+      cache->ports = allocate_port_list(context, port_count);
+    }
+
+    if (port_count && cache->ports) {
+      fill_out_process_ports(&cache->shape, p, Get_Port_List(&context->port_arena, cache->ports));
+      cache->shape.ports = cache->ports;
+    }
+  }
+
+  return &cache->shape;
+}
+
+
+/*
+  Call when anything that every shape depends on changes, like Context_Flag_RoundedShapes or the global shape sizes.
+*/
+function void invalidate_process_shapes(Context *context) {
+  context->shape_epoch += 1;
+  if (context->shape_epoch == 0) {
+    context->shape_epoch = 1;
+  }
+
+  // NOTE: Every shape may have changed size, so every process has to be placed in the grid again.
+  rebuild_spatial_indices(context);
+}
+
+
+/*
+  Every wire's polyline depends on the zoom, so they are all flattened again.
+
+  Nothing calls this yet. proc has no zoom or camera, so the zoom stays at 1 and wires are always flattened for 1:1 pixels. Whatever adds zooming has to go through here, or the polylines will be too coarse or too fine for the new scale.
+*/
+function void set_context_zoom(Context *context, F32 zoom) {
+  context->zoom = zoom;
+  rebuild_spatial_indices(context);
+}
+
+
+
+function Wire_Curve get_wire_curve(Context *context, Wire *wire) {
+  arena *pa = &context->process_arena;
+  Wire_Curve curve = {0};
+
+  Process *out = Get_Process_By_Id(pa, wire->out_id);
+  Process *in = Get_Process_By_Id(pa, wire->in_id);
+  Process_Shape *out_shape = get_process_shape(context, out);
+  Process_Shape *in_shape = get_process_shape(context, in);
+
+  curve.out_position = get_process_wire_out_position(context, out, out_shape, wire->which_out);
+  curve.in_position = get_process_wire_in_position(context, in, in_shape, wire->which_in);
+  curve.out_control = curve.out_position;
+  curve.out_control.y -= Wire_Control_Offset;
+  curve.in_control = curve.in_position;
+  curve.in_control.y += Wire_Control_Offset;
+
+  return curve;
+}
+
+
+/*
+  How many segments keep a polyline within tolerance of the curve, by Wang's formula: for a cubic, n uniform segments are within tolerance once n*n >= (3*2/8) * M / tolerance, M being the length of the largest second difference of the control points.
+*/
+function S32 get_wire_segment_count(Wire_Curve *curve, F32 tolerance) {
+  Vector2 d0 = Vector2Add(Vector2Subtract(curve->out_position, Vector2Scale(curve->out_control, 2.0f)), curve->in_control);
+  Vector2 d1 = Vector2Add(Vector2Subtract(curve->out_control, Vector2Scale(curve->in_control, 2.0f)), curve->in_position);
+  F32 m = sqrtf(Max(Vector2LengthSqr(d0), Vector2LengthSqr(d1)));
+  F32 n = ceilf(sqrtf(0.75f * m / tolerance));
+
+  S32 segment_count = n < (F32)Wire_Max_Segment_Count ? (S32)n : Wire_Max_Segment_Count;
+  segment_count = Max(segment_count, Wire_Min_Segment_Count);
+  return segment_count;
+}
+
+
+/*
+  Flatten the wire's curve into its curve-cache, with as many segments as it needs at the current zoom, and refit its leaf in the scene-tree. If no polyline can be allocated the cache holds just the two ends.
+*/
+function void update_wire_curve_cache(Context *context, Wire_Id wire_id) {
+  arena *ra = &context->port_arena;
+  Wire *wire = Get_Wire_By_Id(&context->wire_arena, wire_id);
+  Wire_Curve_Cache *curve_cache = Get_Wire_Curve_Cache(&context->wire_curve_arena, Id_Index(wire_id));
+  Wire_Curve curve = get_wire_curve(context, wire);
+
+  S32 segment_count = get_wire_segment_count(&curve, Wire_Flatness_Tolerance / context->zoom);
+  if (segment_count+1 > Get_Port_List_Capacity(ra, curve_cache->points)) {
+    free_port_list(context, curve_cache->points);
+    curve_cache->points = allocate_port_list(context, segment_count+1);
+  }
+
+  if (curve_cache->points) {
+    Vector2 *points = Get_Port_List(ra, curve_cache->points);
+    get_bezier_points(curve.out_position, curve.in_position, curve.out_control, curve.in_control, segment_count, points);
+    curve_cache->point_count = segment_count+1;
+    curve_cache->bounds = get_points_bounds(points, curve_cache->point_count);
+  } else {
+    Vector2 ends[2] = {curve.out_position, curve.in_position};
+    curve_cache->point_count = 0;
+    curve_cache->bounds = get_points_bounds(ends, 2);
+  }
+
+  update_scene_leaf(context, &wire->scene_leaf, curve_cache->bounds, Id_Index(wire_id) | Scene_Item_Wire_Bit);
+}
+
+
+/*
+  The area that handle_process_selection can react to: the shape, its wire-boxes and its new-wire-box.
+*/
+function Rectangle get_process_bounds(Context *context, Process *p) {
+  Process_Shape *shape = get_process_shape(context, p);
+  Rectangle shape_bounds = (Rectangle){shape->min.x, shape->min.y, shape->max.x - shape->min.x, shape->max.y - shape->min.y};
+  Rectangle bounds = get_rectangle_union(get_new_wire_box(context, p, shape), shape_bounds);
+
+  for (S32 i = 0; i < p->in_count; ++i) {
+    Vector2 in_position = get_process_wire_in_position(context, p, shape, i);
+    bounds = get_rectangle_union(bounds, get_wire_box(context, in_position));
+  }
+  for (S32 i = 0; i < p->out_count; ++i) {
+    Vector2 out_position = get_process_wire_out_position(context, p, shape, i);
+    bounds = get_rectangle_union(bounds, get_wire_box(context, out_position));
+  }
+
+  return bounds;
+}
+
+
+/*
+  Re-insert every process in the dirty-list into the cells that its current bounds overlap, and refit its leaf and the leaves of its wires in the scene-tree. The wires' flattened curves are refreshed on the way.
+*/
+function void update_spatial_indices(Context *context) {
+  arena *pa = &context->process_arena;
+  arena *wa = &context->wire_arena;
+  arena *ea = &context->edge_arena;
+  arena *sa = &context->shape_arena;
+  arena *da = &context->spatial_dirty_arena;
+  U32 *dirty = (U32 *)da->Data;
+  U32 dirty_count = (U32)(da->Offset / sizeof(U32));
+  U32 pc = Get_Process_Count(pa);
+
+  for (U32 i = 0; i < dirty_count; ++i) {
+    U32 index = dirty[i];
+
+    if (index > 0 && index <= pc) {
+      Process *p = Get_Process_Slot(pa, index);
+      Unset_Flag(p->flags, Process_Flag_SpatialDirty);
+      remove_process_from_grid(context, index);
+
+      if (!Get_Flag(p->flags, Process_Flag_Deleted)) {
+        Process_Shape_Cache *cache = Get_Process_Shape_Cache(sa, index);
+        cache->bounds = get_process_bounds(context, p);
+        cache->cell_min_x = Get_Grid_Cell(cache->bounds.x);
+        cache->cell_min_y = Get_Grid_Cell(cache->bounds.y);
+        cache->cell_max_x = Get_Grid_Cell(cache->bounds.x + cache->bounds.width);
+        cache->cell_max_y = Get_Grid_Cell(cache->bounds.y + cache->bounds.height);
+
+        for (S32 y = cache->cell_min_y; y <= cache->cell_max_y; ++y) {
+          for (S32 x = cache->cell_min_x; x <= cache->cell_max_x; ++x) {
+            grid_insert(context, index, x, y);
+          }
+        }
+        cache->in_grid = 1;
+
+        update_scene_leaf(context, &cache->scene_leaf, cache->bounds, index);
+
+        for (S32 k = 0; k < p->in_count + p->out_count; ++k) {
+          Wire_Id wire_id = k < p->in_count ? Get_Wire_List(ea, p->in_wires)[k] : Get_Wire_List(ea, p->out_wires)[k - p->in_count];
+          update_wire_curve_cache(context, wire_id);
+        }
+      }
+    }
+  }
+
+  da->Offset = 0;
+}
+
+
+/*
+  Find the processes whose bounds contain point, pushed onto the temp-arena in slot order so callers see them in the same order as a walk over the process table would.
+*/
+function U32 *query_process_grid(Context *context, Vector2 point, S32 *result_count) {
+  arena *ga = &context->grid_arena;
+  arena *sa = &context->shape_arena;
+  arena *ta = &context->temp_arena;
+
+  update_spatial_indices(context);
+
+  // NOTE: The temp-arena also holds strings, so align it before the results are pushed one at a time.
+  AlignArena(ta, ryn_memory_AlignOf(U32));
+  U32 *results = (U32 *)(ta->Data + ta->Offset);
+  S32 count = 0;
+
+  U32 node = Get_Grid_Buckets(ga)[get_grid_bucket(Get_Grid_Cell(point.x), Get_Grid_Cell(point.y))];
+  while (node) {
+    Grid_Node *grid_node = Get_Grid_Node(ga, node);
+    Process_Shape_Cache *cache = Get_Process_Shape_Cache(sa, grid_node->process_index);
+
+    // NOTE: The bucket is shared with any cell that hashes to it, so check the bounds.
+    if (rectangle_contains_point(cache->bounds, point)) {
+      // insertion-sort, dropping duplicates from cells of the same process that share a bucket
+      U32 index = grid_node->process_index;
+      S32 j = count;
+      while (j > 0 && results[j-1] > index) {
+        j -= 1;
+      }
+
+      B32 is_duplicate = j > 0 && results[j-1] == index;
+      if (!is_duplicate && ryn_memory_PushStruct(ta, U32)) {
+        for (S32 k = count; k > j; --k) {
+          results[k] = results[k-1];
+        }
+        results[j] = index;
+        count += 1;
+      }
+    }
+
+    node = grid_node->next;
+  }
+
+  *result_count = count;
+  return results;
+}
+
+
+
+/*
+  Clip the segment a-b against r (Liang-Barsky), true if any part of it is inside.
+*/
+function B32 segment_overlaps_rectangle(Vector2 a, Vector2 b, Rectangle r) {
+  F32 d[2] = {b.x - a.x, b.y - a.y};
+  F32 low[2] = {r.x - a.x, r.y - a.y};
+  F32 high[2] = {r.x + r.width - a.x, r.y + r.height - a.y};
+  F32 t0 = 0.0f;
+  F32 t1 = 1.0f;
+  B32 overlaps = 1;
+
+  for (S32 axis = 0; axis < 2 && overlaps; ++axis) {
+    if (d[axis] == 0.0f) {
+      overlaps = low[axis] <= 0.0f && high[axis] >= 0.0f;
+    } else {
+      F32 ta = low[axis] / d[axis];
+      F32 tb = high[axis] / d[axis];
+      t0 = Max(t0, Min(ta, tb));
+      t1 = Min(t1, Max(ta, tb));
+      overlaps = t0 <= t1;
+    }
+  }
+
+  return overlaps;
+}
+
+
+function B32 segments_intersect(Vector2 a, Vector2 b, Vector2 c, Vector2 d) {
+  F32 side_c = orient_2d(a, b, c);
+  F32 side_d = orient_2d(a, b, d);
+  F32 side_a = orient_2d(c, d, a);
+  F32 side_b = orient_2d(c, d, b);
+
+  B32 intersect = 0;
+
+  if (side_a == 0.0f && side_b == 0.0f) {
+    // NOTE: The segments are on the same line, so they intersect if their extents do.
+    Vector2 ab[2] = {a, b};
+    Vector2 cd[2] = {c, d};
+    intersect = rectangles_overlap(get_points_bounds(ab, 2), get_points_bounds(cd, 2));
+  } else {
+    intersect = ((side_c <= 0.0f && side_d >= 0.0f) || (side_c >= 0.0f && side_d <= 0.0f)) &&
+                ((side_a <= 0.0f && side_b >= 0.0f) || (side_a >= 0.0f && side_b <= 0.0f));
+  }
+
+  return intersect;
+}
+
+
+/*
+  Even-odd rule, so self-intersecting lassos behave like they are drawn.
+*/
+function B32 polygon_contains_point(Vector2 *polygon, S32 polygon_count, Vector2 point) {
+  B32 contains = 0;
+
+  for (S32 i = 0, j = polygon_count-1; i < polygon_count; j = i++) {
+    Vector2 a = polygon[i];
+    Vector2 b = polygon[j];
+    if ((a.y > point.y) != (b.y > point.y)) {
+      F32 x = a.x + (point.y - a.y) * (b.x - a.x) / (b.y - a.y);
+      if (point.x < x) {
+        contains = !contains;
+      }
+    }
+  }
+
+  return contains;
+}
+
+
+function B32 polyline_overlaps_polygon(Vector2 *points, S32 point_count, Vector2 *polygon, S32 polygon_count) {
+  B32 overlaps = polygon_contains_point(polygon, polygon_count, points[0]);
+
+  for (S32 i = 0; i < point_count-1 && !overlaps; ++i) {
+    for (S32 j = 0, k = polygon_count-1; j < polygon_count; k = j++) {
+      if (segments_intersect(points[i], points[i+1], polygon[k], polygon[j])) {
+        overlaps = 1;
+        break;
+      }
+    }
+  }
+
+  return overlaps;
+}
 
-        conn_proc->in_count -= 1;
-      }
 
-      if (!out_match) {
-        Process *conn_proc = Get_Process_By_Id(pa, wire->out_id);
+/*
+  Test one scene-tree item against the query region, which is the polygon if there is one, otherwise the rectangle. Processes are tested by the same bounds the grid uses, wires by their flattened curve, so the spatial indices have to be up to date.
+*/
+function B32 scene_item_overlaps_region(Context *context, U32 item, Rectangle box, Vector2 *polygon, S32 polygon_count) {
+  B32 overlaps = 0;
 
-        // adjust out-connections to deleted wire
-        for (S32 j = 1; j <= pc; ++j) {
-          Process *test_wire = Get_Process_By_Id(pa, j);
-          if (test_wire->out_id == wire->out_id &&
-              test_wire->which_out > wire->which_out) {
-            test_wire->which_out -= 1;
-          }
-        }
+  if (item & Scene_Item_Wire_Bit) {
+    Wire_Curve_Cache *curve_cache = Get_Wire_Curve_Cache(&context->wire_curve_arena, item & ~Scene_Item_Wire_Bit);
+    Vector2 *points = Get_Port_List(&context->port_arena, curve_cache->points);
 
-        conn_proc->out_count -= 1;
+    if (!rectangles_overlap(curve_cache->bounds, box)) {
+      overlaps = 0;
+    } else if (polygon) {
+      overlaps = polyline_overlaps_polygon(points, curve_cache->point_count, polygon, polygon_count);
+    } else {
+      for (S32 i = 0; i < curve_cache->point_count-1 && !overlaps; ++i) {
+        overlaps = segment_overlaps_rectangle(points[i], points[i+1], box);
       }
-
-      *wire = (Process){0};
-      Set_Flag(wire->flags, Process_Flag_Deleted);
+    }
+  } else {
+    Rectangle r = Get_Process_Shape_Cache(&context->shape_arena, item)->bounds;
+
+    if (!rectangles_overlap(r, box)) {
+      overlaps = 0;
+    } else if (!polygon) {
+      overlaps = 1;
+    } else if (rectangle_contains_point(r, polygon[0])) {
+      // NOTE: A lasso drawn entirely inside the bounds crosses no edge of them.
+      overlaps = 1;
+    } else {
+      // walk the outline of the bounds
+      Vector2 outline[5];
+      outline[0] = (Vector2){r.x, r.y};
+      outline[1] = (Vector2){r.x + r.width, r.y};
+      outline[2] = (Vector2){r.x + r.width, r.y + r.height};
+      outline[3] = (Vector2){r.x, r.y + r.height};
+      outline[4] = outline[0];
+      overlaps = polyline_overlaps_polygon(outline, 5, polygon, polygon_count);
     }
   }
+
+  return overlaps;
 }
 
 
+function Scene_Query query_scene(Context *context, Rectangle box, Vector2 *polygon, S32 polygon_count) {
+  arena *na = &context->scene_arena;
+  arena *ta = &context->temp_arena;
+  Scene_Query query = {0};
 
-function void connect_processes(Context *context, Process *out, Process *in) {
-  arena *pa = &context->process_arena;
-  Process *new_wire = create_process(context);
+  update_spatial_indices(context);
 
-  if (new_wire) {
-    U32 out_id = Get_Process_Id(pa, out);
-    U32 in_id = Get_Process_Id(pa, in);
+  // NOTE: Like query_process_grid, align the temp-arena before the items are pushed one at a time.
+  AlignArena(ta, ryn_memory_AlignOf(U32));
+  U32 *items = (U32 *)(ta->Data + ta->Offset);
+  S32 item_count = 0;
+  S32 process_count = 0;
 
-    Set_Flag(new_wire->flags, Process_Flag_Wire);
-    new_wire->out_id = out_id;
-    new_wire->in_id = in_id;
+  U32 stack[Scene_Query_Stack_Size];
+  S32 stack_count = 0;
+  if (context->scene_root) {
+    // NOTE: The walk holds at most one pending sibling per level, plus the two children it just pushed, so height+1 entries are enough. The tree is balanced, which keeps the height far below the stack size.
+    Assert(Get_Scene_Node(na, context->scene_root)->height + 1 <= Scene_Query_Stack_Size);
+    stack[stack_count++] = context->scene_root;
+  }
 
-    new_wire->which_out = out->out_count;
-    new_wire->which_in = in->in_count;
+  while (stack_count > 0) {
+    Scene_Node *n = Get_Scene_Node(na, stack[--stack_count]);
 
-    out->out_count += 1;
-    in->in_count += 1;
+    if (rectangles_overlap(n->box, box)) {
+      if (Scene_Node_Is_Leaf(n)) {
+        if (scene_item_overlaps_region(context, n->item, box, polygon, polygon_count) && ryn_memory_PushStruct(ta, U32)) {
+          items[item_count++] = n->item;
+          process_count += (n->item & Scene_Item_Wire_Bit) ? 0 : 1;
+        }
+      } else {
+        stack[stack_count++] = n->left;
+        stack[stack_count++] = n->right;
+      }
+    }
   }
-}
 
+  query.process_ids = ryn_memory_PushAlignedArray(ta, Process_Id, process_count);
+  query.wire_ids = ryn_memory_PushAlignedArray(ta, Wire_Id, item_count - process_count);
 
+  if (query.process_ids && query.wire_ids) {
+    for (S32 i = 0; i < item_count; ++i) {
+      U32 item = items[i];
+      if (item & Scene_Item_Wire_Bit) {
+        Wire *wire = Get_Wire_Slot(&context->wire_arena, item & ~Scene_Item_Wire_Bit);
+        query.wire_ids[query.wire_count++] = Get_Wire_Id(&context->wire_arena, wire);
+      } else {
+        Process *p = Get_Process_Slot(&context->process_arena, item);
+        query.process_ids[query.process_count++] = Get_Process_Id(&context->process_arena, p);
+      }
+    }
+  }
 
-function void
-fill_out_half_circle_shape(Context *context, Process_Shape *shape, Process *p, Vector2 position, B32 downward) {
-  F32 padding = global_process_wire_padding;
-  F32 spacing = global_process_wire_spacing;
+  return query;
+}
 
-  F32 conn_count = (F32)(downward ? p->out_count : p->in_count);
-  F32 width = (2.0f*padding + conn_count*spacing);
-  F32 half_width = 0.5f*(width);
 
-  F32 height = global_shape_size;
-  F32 half_height = global_shape_half_size;
-  shape->kind = Process_Shape_HalfCircle;
-  shape->triangle_count = global_shape_fan_triangle_count;
-  shape->downward = downward;
+/*
+  Find the processes and wires that overlap box, e.g. for box-selection or culling. The results are on the temp-arena, in no particular order.
+*/
+function Scene_Query query_scene_rectangle(Context *context, Rectangle box) {
+  Scene_Query query = query_scene(context, box, 0, 0);
+  return query;
+}
 
-  F32 multiplier = downward ? -1.0f : 1.0f;
-  F32 x_offset = multiplier * half_width;
-  F32 y_offset = multiplier * half_height;
 
-  Vector2 first_point = (Vector2){position.x-x_offset, position.y+y_offset};
-  Vector2 second_point = (Vector2){position.x+x_offset, position.y+y_offset};
-  shape->first_control = (Vector2){first_point.x, first_point.y-2.0f*y_offset};
-  shape->second_control = (Vector2){second_point.x, second_point.y-2.0f*y_offset};
+/*
+  Find the processes and wires that overlap a closed polygon, e.g. for lasso-selection. The results are on the temp-arena, in no particular order.
+*/
+function Scene_Query query_scene_polygon(Context *context, Vector2 *polygon, S32 polygon_count) {
+  Scene_Query query = {0};
 
-  Vector2 middle_of_curve = get_bezier_point(
-    first_point, second_point,
-    shape->first_control, shape->second_control,
-    0.5f);
-  Vector2 middle_of_line = get_percentage_between_points(first_point, second_point, 0.5f);
-  shape->center = get_percentage_between_points(middle_of_curve, middle_of_line, 0.5);
+  if (polygon_count >= 3) {
+    query = query_scene(context, get_points_bounds(polygon, polygon_count), polygon, polygon_count);
+  }
 
-  shape->point_count = create_bezier_triangle_fan(
-    first_point, second_point,
-    shape->first_control, shape->second_control,
-    shape->points, Process_Shape_Max_Points, shape->triangle_count);
+  return query;
 }
 
 
 
-function Process_Shape
-get_process_shape(Context *context, Process *p) {
-  Process_Shape shape = {0};
-
-  Vector2 position = get_process_position(context, p);
+function F32 get_distance_to_segment_squared(Vector2 a, Vector2 b, Vector2 point) {
+  Vector2 ab = Vector2Subtract(b, a);
+  Vector2 ap = Vector2Subtract(point, a);
+  F32 length_squared = Vector2DotProduct(ab, ab);
+  F32 t = length_squared > 0.0f ? Vector2DotProduct(ap, ab) / length_squared : 0.0f;
+  t = Clamp(t, 0.0f, 1.0f);
 
-  F32 quarter_size = global_shape_size / 4.0f;
-  F32 padding = global_process_wire_padding;
-  F32 spacing = global_process_wire_spacing;
+  Vector2 closest = Vector2Add(a, Vector2Scale(ab, t));
+  F32 distance_squared = Vector2DistanceSqr(closest, point);
+  return distance_squared;
+}
 
-  S32 has_in = p->in_count > 0;
-  S32 has_out = p->out_count > 0;
 
-  B32 rounded = Get_Flag(context->flags, Context_Flag_RoundedShapes);
+/*
+  Find the wire whose curve passes closest to point, within Wire_Pick_Distance. Candidates come from the scene-tree, then each wire's tight curve bounds reject it before any of its segments are measured.
+*/
+function Wire *pick_wire(Context *context, Vector2 point) {
+  arena *na = &context->scene_arena;
+  arena *wa = &context->wire_arena;
+  Wire *picked = 0;
+
+  update_spatial_indices(context);
+
+  F32 d = Wire_Pick_Distance;
+  Rectangle pick_box = (Rectangle){point.x - d, point.y - d, 2.0f*d, 2.0f*d};
+  F32 closest_distance_squared = d*d;
+
+  U32 stack[Scene_Query_Stack_Size];
+  S32 stack_count = 0;
+  if (context->scene_root) {
+    // NOTE: The walk holds at most one pending sibling per level, plus the two children it just pushed, so height+1 entries are enough. The tree is balanced, which keeps the height far below the stack size.
+    Assert(Get_Scene_Node(na, context->scene_root)->height + 1 <= Scene_Query_Stack_Size);
+    stack[stack_count++] = context->scene_root;
+  }
 
-  if (has_in && has_out) {
-    // rectangular
-    F32 max_conn = (F32)Max(p->in_count, p->out_count);
-    F32 half_width = 0.5f*(2.0f*padding + max_conn*spacing);
-    shape.kind = Process_Shape_Rectangle;
-    shape.point_count = 4;
-    shape.points[0].x = position.x + half_width;
-    shape.points[0].y = position.y - global_shape_half_size;
-    shape.points[1].x = position.x - half_width;
-    shape.points[1].y = position.y - global_shape_half_size;
-    shape.points[2].x = position.x + half_width;
-    shape.points[2].y = position.y + global_shape_half_size;
-    shape.points[3].x = position.x - half_width;
-    shape.points[3].y = position.y + global_shape_half_size;
-    shape.center = get_percentage_between_points(shape.points[0], shape.points[3], 0.5f);
-  } else if (has_in) {
-    F32 width = (2.0f*padding + p->in_count*spacing);
-    F32 half_width = 0.5f*(width);
-    if (rounded) {
-      // upward half-circle
-      fill_out_half_circle_shape(context, &shape, p, position, 0);
-    } else {
-      // upward triangle
-      shape.kind = Process_Shape_Triangle;
-      shape.point_count = 3;
-      shape.points[0].x = position.x;
-      shape.points[0].y = position.y - quarter_size;
-      shape.points[1].x = position.x - half_width;
-      shape.points[1].y = position.y + global_shape_half_size;
-      shape.points[2].x = position.x + half_width;
-      shape.points[2].y = position.y + global_shape_half_size;
-      Vector2 outer_mid = get_percentage_between_points(shape.points[1], shape.points[2], 0.5f);
-      shape.center = get_percentage_between_points(shape.points[0], outer_mid, 0.66f);
-    }
-  } else if (has_out) {
-    F32 width = (2.0f*padding + p->out_count*spacing);
-    F32 half_width = 0.5f*(width);
-    if (rounded) {
-      // downward half-circle
-      fill_out_half_circle_shape(context, &shape, p, position, 1);
-    } else {
-      // downward triangle
-      shape.kind = Process_Shape_Triangle;
-      shape.point_count = 3;
-      shape.points[0].x = position.x + half_width;
-      shape.points[0].y = position.y - global_shape_half_size;
-      shape.points[1].x = position.x - half_width;
-      shape.points[1].y = position.y - global_shape_half_size;
-      shape.points[2].x = position.x;
-      shape.points[2].y = position.y + quarter_size;
-      Vector2 outer_mid = get_percentage_between_points(shape.points[0], shape.points[1], 0.5f);
-      shape.center = get_percentage_between_points(shape.points[2], outer_mid, 0.66f);
-    }
-  } else {
-    if (rounded) {
-      // circle
-      shape.kind = Process_Shape_Circle;
-      shape.center = position;
-      shape.radius = global_shape_half_size*0.7f;
-    } else {
-      // diamond
-      shape.kind = Process_Shape_Quadrangle;
-      shape.point_count = 4;
-      shape.points[0].x = position.x;
-      shape.points[0].y = position.y - global_shape_half_size;
-      shape.points[1].x = position.x - global_shape_half_size;
-      shape.points[1].y = position.y;
-      shape.points[2].x = position.x + global_shape_half_size;
-      shape.points[2].y = position.y;
-      shape.points[3].x = position.x;
-      shape.points[3].y = position.y + global_shape_half_size;
-      shape.center = get_percentage_between_points(shape.points[0], shape.points[3], 0.5f);
+  while (stack_count > 0) {
+    Scene_Node *n = Get_Scene_Node(na, stack[--stack_count]);
+
+    if (rectangles_overlap(n->box, pick_box)) {
+      if (Scene_Node_Is_Leaf(n)) {
+        U32 index = n->item & ~Scene_Item_Wire_Bit;
+        Wire_Curve_Cache *curve_cache = Get_Wire_Curve_Cache(&context->wire_curve_arena, index);
+
+        if ((n->item & Scene_Item_Wire_Bit) && rectangles_overlap(curve_cache->bounds, pick_box)) {
+          Vector2 *points = Get_Port_List(&context->port_arena, curve_cache->points);
+          for (S32 i = 0; i < curve_cache->point_count-1; ++i) {
+            F32 distance_squared = get_distance_to_segment_squared(points[i], points[i+1], point);
+            if (distance_squared <= closest_distance_squared) {
+              closest_distance_squared = distance_squared;
+              picked = Get_Wire_Slot(wa, index);
+            }
+          }
+        }
+      } else {
+        stack[stack_count++] = n->left;
+        stack[stack_count++] = n->right;
+      }
     }
   }
 
-  return shape;
+  return picked;
 }
 
 
@@ -642,11 +2704,7 @@ triangle_fan_contains_point(Vector2 *points, S32 triangle_count, Vector2 point)
   B32 contains = 0;
 
   for (S32 i = 1; i <= triangle_count; ++i) {
-    F32 side1 = which_side_of_line(points[0], points[i], point);
-    F32 side2 = which_side_of_line(points[i], points[i+1], point);
-    F32 side3 = which_side_of_line(points[i+1], points[0], point);
-
-    if (side1 < 0.0f && side2 < 0.0f && side3 < 0.0f) {
+    if (triangle_contains_point(points[0], points[i], points[i+1], point)) {
       contains = 1;
       break;
     }
@@ -658,60 +2716,172 @@ triangle_fan_contains_point(Vector2 *points, S32 triangle_count, Vector2 point)
 
 
 function B32
-process_shape_contains_point(Context *context, Process_Shape shape, Vector2 point) {
+process_shape_contains_point(Context *context, Process_Shape *shape, Vector2 point) {
   B32 contains = 0;
 
-  switch(shape.kind) {
-  case Process_Shape_Triangle:
-  case Process_Shape_Quadrangle:
-  case Process_Shape_Rectangle: {
-    if (shape.point_count == 3 || shape.point_count == 4) {
-      F32 side1 = which_side_of_line(shape.points[0], shape.points[1], point);
-      F32 side2 = which_side_of_line(shape.points[1], shape.points[2], point);
-      F32 side3 = which_side_of_line(shape.points[2], shape.points[0], point);
-
-      // test first triangle
-      if (side1 < 0.0f && side2 < 0.0f && side3 < 0.0f) {
-        contains = 1;
-      } else if (shape.point_count == 4) {
-        F32 side4 = which_side_of_line(shape.points[2], shape.points[3], point);
-        F32 side5 = which_side_of_line(shape.points[3], shape.points[1], point);
-
-        // test second triangle
-        if (side2 > 0.0f && side4 > 0.0f && side5 > 0.0f) {
-          contains = 1;
-        }
+  if (point.x >= shape->min.x && point.y >= shape->min.y && point.x <= shape->max.x && point.y <= shape->max.y) {
+    for (S32 i = 0; i < shape->triangle_count && !contains; ++i) {
+      U8 *triangle = shape->triangles[i];
+      contains = triangle_contains_point(shape->points[triangle[0]], shape->points[triangle[1]], shape->points[triangle[2]], point);
+    }
+  }
+
+  return contains;
+}
+
+
+
+/*
+  The meshes of many shapes gathered into one batch, so many points can be tested against them, e.g. every point of a lasso against the shapes it might select. Like process_shape_contains_point, a point is tested against a shape's bounds first, four shapes at a time, and only the shapes whose bounds contain it have their triangles tested.
+*/
+typedef struct {
+  S32 shape_count;
+  F32 *min_x;
+  F32 *min_y;
+  F32 *max_x;
+  F32 *max_y;
+  // NOTE: Shape i owns the triangles from triangle_starts[i] up to triangle_starts[i+1].
+  S32 *triangle_starts;
+  Triangle_Batch triangles;
+  B32 *triangle_results;
+} Process_Shape_Batch;
+
+
+/*
+  Builds the batch on arena a. If a runs out of memory the batch is left empty, and testing it finds nothing.
+*/
+function Process_Shape_Batch build_process_shape_batch(arena *a, Process_Shape **shapes, S32 shape_count) {
+  Process_Shape_Batch batch = {0};
+
+  S32 max_triangle_count = 0;
+  for (S32 i = 0; i < shape_count; ++i) {
+    max_triangle_count += shapes[i]->triangle_count;
+  }
+
+  Triangle_Batch *tb = &batch.triangles;
+  batch.min_x = ryn_memory_PushAlignedArray(a, F32, shape_count);
+  batch.min_y = ryn_memory_PushAlignedArray(a, F32, shape_count);
+  batch.max_x = ryn_memory_PushAlignedArray(a, F32, shape_count);
+  batch.max_y = ryn_memory_PushAlignedArray(a, F32, shape_count);
+  batch.triangle_starts = ryn_memory_PushAlignedArray(a, S32, shape_count+1);
+  tb->ax = ryn_memory_PushAlignedArray(a, F32, max_triangle_count);
+  tb->ay = ryn_memory_PushAlignedArray(a, F32, max_triangle_count);
+  tb->bx = ryn_memory_PushAlignedArray(a, F32, max_triangle_count);
+  tb->by = ryn_memory_PushAlignedArray(a, F32, max_triangle_count);
+  tb->cx = ryn_memory_PushAlignedArray(a, F32, max_triangle_count);
+  tb->cy = ryn_memory_PushAlignedArray(a, F32, max_triangle_count);
+  batch.triangle_results = ryn_memory_PushAlignedArray(a, B32, max_triangle_count);
+
+  B32 allocated = (batch.min_x && batch.min_y && batch.max_x && batch.max_y && batch.triangle_starts &&
+                   tb->ax && tb->ay && tb->bx && tb->by && tb->cx && tb->cy && batch.triangle_results);
+
+  if (allocated) {
+    batch.shape_count = shape_count;
+
+    for (S32 i = 0; i < shape_count; ++i) {
+      Process_Shape *shape = shapes[i];
+      batch.min_x[i] = shape->min.x;
+      batch.min_y[i] = shape->min.y;
+      batch.max_x[i] = shape->max.x;
+      batch.max_y[i] = shape->max.y;
+      batch.triangle_starts[i] = tb->count;
+
+      for (S32 j = 0; j < shape->triangle_count; ++j) {
+        Vector2 a = shape->points[shape->triangles[j][0]];
+        Vector2 b = shape->points[shape->triangles[j][1]];
+        Vector2 c = shape->points[shape->triangles[j][2]];
+        S32 t = tb->count++;
+        tb->ax[t] = a.x; tb->ay[t] = a.y;
+        tb->bx[t] = b.x; tb->by[t] = b.y;
+        tb->cx[t] = c.x; tb->cy[t] = c.y;
       }
     }
-  } break;
-  case Process_Shape_Circle: {
-    F32 distance = Vector2Distance(shape.center, point);
-    contains = distance <= shape.radius;
-  } break;
-  case Process_Shape_HalfCircle: {
-    contains = triangle_fan_contains_point(shape.points, shape.triangle_count, point);
-  } break;
+
+    batch.triangle_starts[shape_count] = tb->count;
+  }
+
+  return batch;
+}
+
+
+/*
+  Test point against the triangles of the batch's shape i, once its bounds are known to contain the point.
+*/
+function B32 process_shape_batch_triangles_contain_point(Process_Shape_Batch *batch, S32 i, Vector2 point) {
+  Triangle_Batch *tb = &batch->triangles;
+  S32 start = batch->triangle_starts[i];
+  S32 count = batch->triangle_starts[i+1] - start;
+  Triangle_Batch shape_triangles = {tb->ax + start, tb->ay + start, tb->bx + start, tb->by + start, tb->cx + start, tb->cy + start, count};
+  B32 *triangle_results = batch->triangle_results + start;
+  B32 contains = 0;
+
+  triangle_batch_contains_point(&shape_triangles, point, triangle_results);
+  for (S32 t = 0; t < count; ++t) {
+    contains |= triangle_results[t];
   }
 
   return contains;
 }
 
 
+/*
+  The batched version of process_shape_contains_point: results[i] is set when the batch's shape i contains point.
+*/
+function void process_shape_batch_contains_point(Process_Shape_Batch *batch, Vector2 point, B32 *results) {
+  S32 i = 0;
+
+  // NOTE: Most shapes' bounds miss the point, so clear every result up front and only write the shapes whose bounds contain it.
+  for (S32 j = 0; j < batch->shape_count; ++j) {
+    results[j] = 0;
+  }
+
+#if Lane_Width == 4
+  F32x4 px = F32x4_Set1(point.x);
+  F32x4 py = F32x4_Set1(point.y);
+
+  for (; i + 4 <= batch->shape_count; i += 4) {
+    Mask32x4 outside_x = F32x4_Or(F32x4_Less_Than(px, F32x4_Load(batch->min_x + i)), F32x4_Less_Than(F32x4_Load(batch->max_x + i), px));
+    Mask32x4 outside_y = F32x4_Or(F32x4_Less_Than(py, F32x4_Load(batch->min_y + i)), F32x4_Less_Than(F32x4_Load(batch->max_y + i), py));
+    U32 inside_bits = ~F32x4_Mask_Bits(F32x4_Or(outside_x, outside_y)) & 0xf;
+
+    while (inside_bits) {
+      S32 k = 0;
+      while (!((inside_bits >> k) & 1)) {
+        k += 1;
+      }
+      inside_bits &= ~(1u << k);
+      results[i+k] = process_shape_batch_triangles_contain_point(batch, i+k, point);
+    }
+  }
+#endif
+
+  for (; i < batch->shape_count; ++i) {
+    B32 in_bounds = (point.x >= batch->min_x[i] && point.y >= batch->min_y[i] &&
+                     point.x <= batch->max_x[i] && point.y <= batch->max_y[i]);
+    if (in_bounds) {
+      results[i] = process_shape_batch_triangles_contain_point(batch, i, point);
+    }
+  }
+}
+
+
 
 function Process_Selection
 handle_process_selection(Context *context, Process *p) {
   arena *pa = &context->process_arena;
+  arena *wa = &context->wire_arena;
   Process_Selection selection = {0};
   selection.index = -1;
   selection.process_id = Get_Process_Id(pa, p);
 
-  Process_Shape shape = get_process_shape(context, p);
+  Process_Shape *shape = get_process_shape(context, p);
   Rectangle new_wire_box = get_new_wire_box(context, p, shape);
 
   if (rectangle_contains_point(new_wire_box, context->mouse_position)) {
     // check new-wire-box
     selection.type = Process_Selection_NewWire;
     context->hot_id = selection.process_id;
+    context->hot_wire_id = 0;
     selection.hot_id_assigned = 1;
   } else {
     // check in wire-boxes
@@ -721,9 +2891,9 @@ handle_process_selection(Context *context, Process *p) {
       if (rectangle_contains_point(r, context->mouse_position)) {
         selection.type = Process_Selection_In;
         selection.index = i;
-        Process *wire = get_process_wire_by_selection(context, selection);
-        Process_Id wire_id = Get_Process_Id(pa, wire);
-        context->hot_id = wire_id;
+        Wire *wire = get_process_wire_by_selection(context, selection);
+        context->hot_id = 0;
+        context->hot_wire_id = Get_Wire_Id(wa, wire);
         selection.hot_id_assigned = 1;
         break;
       }
@@ -737,9 +2907,9 @@ handle_process_selection(Context *context, Process *p) {
         if (rectangle_contains_point(r, context->mouse_position)) {
           selection.type = Process_Selection_Out;
           selection.index = i;
-          Process *wire = get_process_wire_by_selection(context, selection);
-          Process_Id wire_id = Get_Process_Id(pa, wire);
-          context->hot_id = wire_id;
+          Wire *wire = get_process_wire_by_selection(context, selection);
+          context->hot_id = 0;
+          context->hot_wire_id = Get_Wire_Id(wa, wire);
           selection.hot_id_assigned = 1;
           break;
         }
@@ -751,6 +2921,7 @@ handle_process_selection(Context *context, Process *p) {
         // process selection
         selection.type = Process_Selection_Process;
         context->hot_id = selection.process_id;
+        context->hot_wire_id = 0;
         selection.hot_id_assigned = 1;
       }
     }
@@ -762,9 +2933,29 @@ handle_process_selection(Context *context, Process *p) {
 
 
 
+/*
+  Whether anything arrived since the last frame that handle_user_input could react to. Call it before handle_user_input, which overwrites the mouse position it compares against.
+*/
+function B32 has_user_input(Context *context) {
+  Vector2 mouse_position = GetMousePosition();
+  B32 has_input = (mouse_position.x != context->mouse_position.x ||
+                   mouse_position.y != context->mouse_position.y ||
+                   IsMouseButtonPressed(0) ||
+                   IsMouseButtonReleased(0) ||
+                   IsWindowResized());
+
+  for (S32 key = 1; key <= KEY_KB_MENU && !has_input; ++key) {
+    has_input = IsKeyPressed(key);
+  }
+
+  return has_input;
+}
+
 function void handle_user_input(Context *context) {
   arena *pa = &context->process_arena;
-  S32 pc = Get_Process_Count(pa);
+  arena *wa = &context->wire_arena;
+  arena *ta = &context->temp_arena;
+  ryn_memory_BeginArena(ta);
 
   context->mouse_position = GetMousePosition();
   B32 mouse_pressed = IsMouseButtonPressed(0);
@@ -772,11 +2963,20 @@ function void handle_user_input(Context *context) {
   B32 process_clicked = 0;
   B32 hot_id_assigned = 0;
 
-  // process interaction
-  for (S32 i = 1; i <= pc; ++i) {
-    Process *p = Get_Process_By_Id(pa, i);
+  if (Get_Flag(context->flags, Context_Flag_Dragging) && context->active_id) {
+    // NOTE: The dragged process moves with the mouse without its stored position changing.
+    mark_process_spatial_dirty(context, Get_Process_By_Id(pa, context->active_id));
+  }
+
+  // process interaction, only with the processes under the mouse
+  S32 candidate_count = 0;
+  U32 *candidates = query_process_grid(context, context->mouse_position, &candidate_count);
+
+  for (S32 i = 0; i < candidate_count; ++i) {
+    Process *p = Get_Process_Slot(pa, candidates[i]);
 
     if (!Get_Flag(p->flags, Process_Flag_Deleted)) {
+      Process_Id id = Get_Process_Id(pa, p);
       Process_Selection selection = handle_process_selection(context, p);
       hot_id_assigned = selection.hot_id_assigned || hot_id_assigned;
 
@@ -784,10 +2984,12 @@ function void handle_user_input(Context *context) {
         if (selection.type == Process_Selection_In ||
             selection.type == Process_Selection_Out) {
           // select wire
-          Process *wire = get_process_wire_by_selection(context, selection);
+          Wire *wire = get_process_wire_by_selection(context, selection);
           if (wire) {
-            Process_Id wire_id = Get_Process_Id(pa, wire);
-            context->active_id = wire_id;
+            context->active_id = 0;
+            context->active_wire_id = Get_Wire_Id(wa, wire);
+            context->hot_wire_id = 0;
+            Unset_Flag(context->flags, Context_Flag_NewWire|Context_Flag_EditText);
             if (selection.type == Process_Selection_In) {
               context->hot_id = wire->in_id;
             } else if (selection.type == Process_Selection_Out) {
@@ -795,11 +2997,12 @@ function void handle_user_input(Context *context) {
             }
             process_clicked = 1;
           }
-        } else if ((context->active_id == i || context->hot_id == i) &&
+        } else if ((context->active_id == id || context->hot_id == id) &&
                    selection.type == Process_Selection_NewWire) {
           // begin new-wire
           Set_Flag(context->flags, Context_Flag_NewWire);
-          context->active_id = i;
+          context->active_id = id;
+          context->active_wire_id = 0;
           process_clicked = 1;
         } else if (selection.type == Process_Selection_Process) {
           if (Get_Flag(context->flags, Context_Flag_NewWire)) {
@@ -808,8 +3011,9 @@ function void handle_user_input(Context *context) {
             connect_processes(context, active_p, p);
           } else {
             // select process
-            context->hot_id = i;
-            context->active_id = i;
+            context->hot_id = id;
+            context->active_id = id;
+            context->active_wire_id = 0;
             U32 unset_flags = (Context_Flag_NewWire |
                                Context_Flag_EditText);
             Unset_Flag(context->flags, unset_flags);
@@ -820,7 +3024,8 @@ function void handle_user_input(Context *context) {
         }
       } else if (selection.type == Process_Selection_Process) {
         // process hover
-        context->hot_id = i;
+        context->hot_id = id;
+        context->hot_wire_id = 0;
       }
 
       // break if there has been an interaction
@@ -831,9 +3036,29 @@ function void handle_user_input(Context *context) {
 
   }
 
+  // wire-body interaction, when nothing on a process is under the mouse
+  if (!hot_id_assigned && !Get_Flag(context->flags, Context_Flag_Dragging|Context_Flag_NewWire)) {
+    Wire *wire = pick_wire(context, context->mouse_position);
+
+    if (wire) {
+      context->hot_id = 0;
+      context->hot_wire_id = Get_Wire_Id(wa, wire);
+      hot_id_assigned = 1;
+
+      if (mouse_pressed) {
+        // select wire
+        context->active_id = 0;
+        context->active_wire_id = context->hot_wire_id;
+        Unset_Flag(context->flags, Context_Flag_NewWire|Context_Flag_EditText);
+        process_clicked = 1;
+      }
+    }
+  }
+
   // zero the old hot-id
   if (!hot_id_assigned) {
     context->hot_id = 0;
+    context->hot_wire_id = 0;
   }
 
   // handle active-id
@@ -843,23 +3068,21 @@ function void handle_user_input(Context *context) {
     if (is_dragging && !mouse_down) {
       // stop dragging
       Vector2 new_position = get_process_position(context, p);
-      p->position = new_position;
+      set_process_position(context, p, new_position);
       Unset_Flag(context->flags, Context_Flag_Dragging);
     } else if (Get_Flag(context->flags, Context_Flag_EditText)) {
       // process label editing
       U32 c = 0;
       B32 shift_down = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
       while ((c = GetKeyPressed())) {
-        if (Is_Editable_Char(c) && p->label_cursor < Process_Label_Size-1) {
+        if (Is_Editable_Char(c)) {
           B32 is_alpha = c >= 'A' && c <= 'Z';
           if (is_alpha && !shift_down) {
             c += 32;
           }
-          p->label[p->label_cursor] = c&0xff;
-          p->label_cursor += 1;
-        } else if (c == KEY_BACKSPACE && p->label_cursor > 0) {
-          p->label_cursor -= 1;
-          p->label[p->label_cursor] = 0;
+          push_label_char(context, p, c&0xff);
+        } else if (c == KEY_BACKSPACE) {
+          pop_label_char(context, p);
         }
       }
     } else if (IsKeyPressed(KEY_I)) {
@@ -867,28 +3090,35 @@ function void handle_user_input(Context *context) {
       Set_Flag(context->flags, Context_Flag_EditText);
     } else if (IsKeyPressed(KEY_TAB)) {
       // cycle through special process types (cups/caps/empty)
-      if (!Get_Flag(p->flags, Process_Flag_Wire)) {
-        if ((p->in_count == 0 && p->out_count == 0) ||
-            (p->in_count == 1 && p->out_count == 0) ||
-            (p->in_count == 0 && p->out_count == 1)) {
-          Toggle_Flag(p->flags, Process_Flag_Empty);
-        } else if (p->in_count == 0 && p->out_count == 2) {
-          Toggle_Flag(p->flags, Process_Flag_Cup);
-        } else if (p->in_count == 2 && p->out_count == 0) {
-          Toggle_Flag(p->flags, Process_Flag_Cap);
-        }
+      if ((p->in_count == 0 && p->out_count == 0) ||
+          (p->in_count == 1 && p->out_count == 0) ||
+          (p->in_count == 0 && p->out_count == 1)) {
+        Toggle_Flag(p->flags, Process_Flag_Empty);
+      } else if (p->in_count == 0 && p->out_count == 2) {
+        Toggle_Flag(p->flags, Process_Flag_Cup);
+      } else if (p->in_count == 2 && p->out_count == 0) {
+        Toggle_Flag(p->flags, Process_Flag_Cap);
       }
+      // NOTE: The shape and the port positions depend on these flags.
+      mark_process_spatial_dirty(context, p);
     } else if (IsKeyPressed(KEY_BACKSPACE)) {
       // delete process
       delete_process(context, p);
     }
+  } else if (context->active_wire_id) {
+    if (IsKeyPressed(KEY_BACKSPACE)) {
+      // delete wire
+      Wire *wire = Get_Wire_By_Id(wa, context->active_wire_id);
+      delete_wire(context, wire);
+    }
   }
 
   // non-process clicks
   if (mouse_pressed && !process_clicked) {
-    if (context->active_id) {
-      // un-select process
+    if (context->active_id || context->active_wire_id) {
+      // un-select process or wire
       context->active_id = 0;
+      context->active_wire_id = 0;
       U32 flags_to_unset = (Context_Flag_NewWire|
                             Context_Flag_EditText);
       Unset_Flag(context->flags, flags_to_unset);
@@ -896,7 +3126,7 @@ function void handle_user_input(Context *context) {
       // new process
       Process *new_p = create_process(context);
       if (new_p) {
-        new_p->position = context->mouse_position;
+        set_process_position(context, new_p, context->mouse_position);
       }
     }
   }
@@ -906,16 +3136,32 @@ function void handle_user_input(Context *context) {
     if (IsKeyPressed(KEY_M)) {
       // toggle between rounded and triangular shapes
       Toggle_Flag(context->flags, Context_Flag_RoundedShapes);
+      invalidate_process_shapes(context);
     }
   }
+
+  ryn_memory_EndArena(ta);
 }
 
 
 
+/*
+  Layers are drawn from the bottom up, and the commands on a layer in the order they were pushed. Every part of a process goes on the same layer, so a process is drawn over the processes before it, fill and outline and label alike, and the same goes for wires and their boxes. The layers are pushed in order too, which lets render_Commands batch them without sorting.
+*/
+typedef enum {
+  Draw_Layer_Background,
+  Draw_Layer_Process,
+  Draw_Layer_Wire,
+  Draw_Layer_Overlay,
+} Draw_Layer;
+
 function void draw_processes(Context *context) {
   arena *pa = &context->process_arena;
+  arena *wa = &context->wire_arena;
+  arena *la = &context->label_arena;
   arena *ra = &context->render_arena;
   S32 pc = Get_Process_Count(pa);
+  S32 wc = Get_Wire_Count(wa);
 
   Color bg_color = (Color){255, 255, 255, 255};
   Color stroke_color = (Color){0, 0, 0, 255};
@@ -926,16 +3172,20 @@ function void draw_processes(Context *context) {
   F32 padding = global_process_wire_padding;
   F32 spacing = global_process_wire_spacing;
 
+  // NOTE: Wires are drawn from their flattened curves, so bring them up to date with anything that moved this frame.
+  update_spatial_indices(context);
+
   // draw processes
+  render_SetLayer(Draw_Layer_Process);
   for (S32 i = 1; i <= pc; ++i) {
-    Process *p = Get_Process_By_Id(pa, i);
-    B32 is_wire = Get_Flag(p->flags, Process_Flag_Wire);
+    Process *p = Get_Process_Slot(pa, i);
 
-    if (!is_wire && !Get_Flag(p->flags, Process_Flag_Deleted)) {
-      Process_Shape shape = get_process_shape(context, p);
+    if (!Get_Flag(p->flags, Process_Flag_Deleted)) {
+      Process_Id id = Get_Process_Id(pa, p);
+      Process_Shape *shape = get_process_shape(context, p);
 
-      B32 is_hot = context->hot_id == i;
-      B32 is_active = context->active_id == i;
+      B32 is_hot = context->hot_id == id;
+      B32 is_active = context->active_id == id;
       F32 thickness = (is_hot||is_active) ? 3.0f : 2.0f;
       F32 cup_cap_control_offset = 10.0f;
 
@@ -954,71 +3204,29 @@ function void draw_processes(Context *context) {
         Vector2 ctrl1 = (Vector2){pos1.x, pos1.y-cup_cap_control_offset};
         render_DrawLineBezierCubic(ra, pos0, pos1, ctrl0, ctrl1, thickness, stroke_color);
       } else {
-        switch(shape.kind) {
-        case Process_Shape_Triangle:
-        case Process_Shape_Quadrangle:
-        case Process_Shape_Rectangle: {
-          // draw process background
-          render_DrawTriangleStrip(ra, shape.points, shape.point_count, bg_color);
-
-          // draw process lines
-          Vector2 p0 = shape.points[0];
-          Vector2 p1 = shape.points[1];
-          Vector2 p2 = shape.points[2];
-          Vector2 p3 = shape.points[3];
-          if (shape.point_count == 3) {
-            render_DrawLine(ra, p0.x, p0.y, p1.x, p1.y, thickness, stroke_color);
-            render_DrawLine(ra, p1.x, p1.y, p2.x, p2.y, thickness, stroke_color);
-            render_DrawLine(ra, p2.x, p2.y, p0.x, p0.y, thickness, stroke_color);
-          } else if (shape.point_count == 4) {
-            render_DrawLine(ra, p0.x, p0.y, p1.x, p1.y, thickness, stroke_color);
-            render_DrawLine(ra, p1.x, p1.y, p3.x, p3.y, thickness, stroke_color);
-            render_DrawLine(ra, p3.x, p3.y, p2.x, p2.y, thickness, stroke_color);
-            render_DrawLine(ra, p2.x, p2.y, p0.x, p0.y, thickness, stroke_color);
-          }
-        } break;
-        case Process_Shape_Circle: {
-          render_DrawCircle(ra, shape.center, shape.radius, bg_color);
-          F32 fudge = Half_Circle_Fudge*shape.radius;
-          Vector2 first_point = (Vector2){shape.center.x-shape.radius, shape.center.y};
-          Vector2 second_point = (Vector2){shape.center.x+shape.radius, shape.center.y};
-          Vector2 control0 = (Vector2){first_point.x, first_point.y-fudge};
-          Vector2 control1 = (Vector2){second_point.x, second_point.y-fudge};
-          render_DrawLineBezierCubic(ra, first_point, second_point, control0, control1, thickness, stroke_color);
-          Vector2 control2 = (Vector2){first_point.x, first_point.y+fudge};
-          Vector2 control3 = (Vector2){second_point.x, second_point.y+fudge};
-          render_DrawLineBezierCubic(ra, first_point, second_point, control2, control3, thickness, stroke_color);
-        } break;
-        case Process_Shape_HalfCircle: {
-          // draw half-circle background
-          render_DrawTriangleFan(ra, shape.points, shape.point_count, bg_color);
-          // draw half-circle lines
-          for (S32 i = 0; i < shape.point_count-1; ++i) {
-            Vector2 p0 = shape.points[i];
-            Vector2 p1 = shape.points[i+1];
-            render_DrawLine(ra, p0.x, p0.y, p1.x, p1.y, thickness, stroke_color);
-          }
-          // connect the line endpoints
-          render_DrawLine(ra,
-                          shape.points[0].x,
-                          shape.points[0].y,
-                          shape.points[shape.point_count-1].x,
-                          shape.points[shape.point_count-1].y,
-                          thickness, stroke_color);
-        } break;
+        // draw process background, straight from the cached shape
+        render_DrawTriangleMesh(ra, shape->points, shape->triangles, shape->triangle_count, bg_color);
+
+        // draw process outline, as one strip with joins at the corners
+        Vector2 outline[Process_Shape_Max_Points];
+        Vector2 strip[Stroke_Max_Strip_Count(Process_Shape_Max_Points)];
+        for (S32 j = 0; j < shape->outline_count; ++j) {
+          outline[j] = shape->points[shape->outline[j]];
         }
+        S32 strip_count = get_polygon_stroke(outline, shape->outline_count, thickness, strip);
+        render_DrawTriangleStrip(ra, strip, strip_count, stroke_color);
       }
 
       // draw label
-      if (p->label[0]) {
-        const char *text = (char *)p->label;
+      if (Get_Label_Size(la, p->label)) {
+        const char *text = get_process_label(context, p);
         F32 text_width = (F32)MeasureText(text, global_process_font_size);
-        F32 text_x = shape.center.x-0.5f*text_width;
-        F32 text_y = shape.center.y-0.5f*global_process_font_size;
-        if (shape.kind == Process_Shape_HalfCircle) {
-          F32 flip = shape.downward ? -1.0f : 1.0f;
+        F32 text_x = shape->center.x-0.5f*text_width;
+        F32 text_y = shape->center.y-0.5f*global_process_font_size;
+        if (shape->kind == Process_Shape_HalfCircle) {
+          F32 flip = shape->downward ? -1.0f : 1.0f;
           F32 fudge = 0.9f;
-          F32 offset = fudge * flip * (0.5f * shape.radius);
+          F32 offset = fudge * flip * (0.5f * shape->radius);
           text_y -= offset;
         }
         render_DrawText(ra, text, text_x, text_y, global_process_font_size, text_color, 0);
@@ -1037,34 +3245,30 @@ function void draw_processes(Context *context) {
   }
 
   // draw wires
-  for (S32 i = 1; i <= pc; ++i) {
-    Process *p = Get_Process_By_Id(pa, i);
-    B32 is_wire = Get_Flag(p->flags, Process_Flag_Wire);
-
-    if (is_wire && !Get_Flag(p->flags, Process_Flag_Deleted)) {
-      Process *out = Get_Process_By_Id(pa, p->out_id);
-      Process *in = Get_Process_By_Id(pa, p->in_id);
-
-      Process_Shape out_shape = get_process_shape(context, out);
-      Process_Shape in_shape = get_process_shape(context, in);
-
-      Vector2 out_position = get_process_wire_out_position(context, out, out_shape, p->which_out);
-      Vector2 in_position = get_process_wire_in_position(context, in, in_shape, p->which_in);
-
-      Vector2 out_control = out_position;
-      out_control.y -= 30.0f;
-      Vector2 in_control = in_position;
-      in_control.y += 30.0f;
-
-      B32 is_active = context->active_id == i || context->hot_id == i;
-      B32 connected_in_active = (context->active_id == p->in_id ||
-                                 context->hot_id == p->in_id);
-      B32 connected_out_active = (context->active_id == p->out_id ||
-                                  context->hot_id == p->out_id);
+  for (S32 i = 1; i <= wc; ++i) {
+    Wire *w = Get_Wire_Slot(wa, i);
+
+    if (!Wire_Is_Deleted(w)) {
+      Wire_Id id = Get_Wire_Id(wa, w);
+      Wire_Curve_Cache *curve_cache = Get_Wire_Curve_Cache(&context->wire_curve_arena, i);
+      Wire_Curve curve = get_wire_curve(context, w);
+      Vector2 out_position = curve.out_position;
+      Vector2 in_position = curve.in_position;
+
+      B32 is_active = context->active_wire_id == id || context->hot_wire_id == id;
+      B32 connected_in_active = (context->active_id == w->in_id ||
+                                 context->hot_id == w->in_id);
+      B32 connected_out_active = (context->active_id == w->out_id ||
+                                  context->hot_id == w->out_id);
       F32 thickness = is_active ? 4.0f : 2.0f;
 
       // draw wire
-      render_DrawLineBezierCubic(ra, out_position, in_position, out_control, in_control, thickness, stroke_color);
+      render_SetLayer(Draw_Layer_Wire);
+      if (curve_cache->point_count) {
+        render_DrawSplineLinear(ra, Get_Port_List(&context->port_arena, curve_cache->points), curve_cache->point_count, thickness, stroke_color);
+      } else {
+        render_DrawLineBezierCubic(ra, out_position, in_position, curve.out_control, curve.in_control, thickness, stroke_color);
+      }
 
       // draw out wire-box
       if (connected_out_active || is_active) {
@@ -1083,9 +3287,10 @@ function void draw_processes(Context *context) {
   }
 
   // draw new wire
+  render_SetLayer(Draw_Layer_Overlay);
   if (Get_Flag(context->flags, Context_Flag_NewWire) && context->active_id) {
     Process *p = Get_Process_By_Id(pa, context->active_id);
-    Process_Shape shape = get_process_shape(context, p);
+    Process_Shape *shape = get_process_shape(context, p);
     Vector2 position = get_new_wire_position(context, p, shape);
 
     Vector2 from_control = position;
@@ -1105,8 +3310,12 @@ function void draw_info_panel(Context *context) {
   arena *ra = &context->render_arena;
   Color text_color = (Color){0, 0, 0, 255};
 
+  render_SetLayer(Draw_Layer_Overlay);
   if (context->active_id) {
-    const char *text = TextFormat("active-id = %d", context->active_id);
+    const char *text = TextFormat("active-id = %u (generation %u)", Id_Index(context->active_id), Id_Generation(context->active_id));
+    render_DrawText(ra, text, 5.0f, 5.0f, global_panel_font_size, text_color, 1);
+  } else if (context->active_wire_id) {
+    const char *text = TextFormat("active-wire-id = %u (generation %u)", Id_Index(context->active_wire_id), Id_Generation(context->active_wire_id));
     render_DrawText(ra, text, 5.0f, 5.0f, global_panel_font_size, text_color, 1);
   }
 }
@@ -1115,13 +3324,33 @@ function void draw_info_panel(Context *context) {
 
 
 
+/*
+  Every arena reserves a large range of address space up front and only commits memory as it is used, so diagrams can grow to millions of processes without pointers into the arenas ever moving.
+*/
+#define Context_Arena_Reserve_Size Gigabytes(16)
+
 function Context initialize_context(void) {
   Context context = (Context){};
 
-  context.render_arena = CreateArena(Megabytes(1));
-  context.process_arena = CreateArena(Megabytes(1));
-  context.temp_arena = CreateArena(Megabytes(1));
+  context.render_arena = CreateGrowableArena(Context_Arena_Reserve_Size);
+  context.process_arena = CreateGrowableArena(Context_Arena_Reserve_Size);
+  context.wire_arena = CreateGrowableArena(Context_Arena_Reserve_Size);
+  context.edge_arena = CreateGrowableArena(Context_Arena_Reserve_Size);
+  context.label_arena = CreateGrowableArena(Context_Arena_Reserve_Size);
+  context.shape_arena = CreateGrowableArena(Context_Arena_Reserve_Size);
+  context.port_arena = CreateGrowableArena(Context_Arena_Reserve_Size);
+  context.grid_arena = CreateGrowableArena(Context_Arena_Reserve_Size);
+  context.spatial_dirty_arena = CreateGrowableArena(Context_Arena_Reserve_Size);
+  context.scene_arena = CreateGrowableArena(Context_Arena_Reserve_Size);
+  context.wire_curve_arena = CreateGrowableArena(Context_Arena_Reserve_Size);
+  context.temp_arena = CreateGrowableArena(Context_Arena_Reserve_Size);
+  ryn_memory_PushZeroArray(&context.grid_arena, U32, Grid_Bucket_Count);
+  ryn_memory_PushZeroStruct(&context.grid_arena, Grid_Node); // NOTE: unused first grid-node
+  ryn_memory_PushZeroStruct(&context.scene_arena, Scene_Node); // NOTE: unused first scene-node
   create_process(&context); // NOTE: unused first process
+  create_wire(&context); // NOTE: unused first wire
+  context.shape_epoch = 1;
+  context.zoom = 1.0f;
 
   return context;
 }
@@ -1129,6 +3358,7 @@ function Context initialize_context(void) {
 
 
 
+#if !defined(Proc_Bench)
 int main(void) {
   Context context = initialize_context();
 
@@ -1138,20 +3368,44 @@ int main(void) {
 
   InitWindow(800, 500, "proc");
   SetTargetFPS(60);
+  // NOTE: The rlgl backend is only measured against raylib with a stubbed-out GPU so far, so stay on raylib until bench_render_submission has been run on a real one.
+  render_LoadBackend(render_backend_Raylib);
+
+  // NOTE: The first frame is drawn before any input has arrived.
+  B32 needs_redraw = 1;
 
   while (!WindowShouldClose()) {
-    handle_user_input(&context);
+    needs_redraw = has_user_input(&context) || needs_redraw;
+
+    if (needs_redraw) {
+      handle_user_input(&context);
 
-    render_ClearBackground(ra, global_background_color);
-    draw_processes(&context);
-    draw_info_panel(&context);
+      // NOTE: Only compact between interactions, while nothing is being dragged or wired up.
+      B32 is_idle = !Get_Flag(context.flags, Context_Flag_Dragging|Context_Flag_NewWire) && !IsMouseButtonDown(0);
+      if (is_idle && should_compact_context(&context)) {
+        compact_context(&context);
+      }
+
+      render_SetLayer(Draw_Layer_Background);
+      render_ClearBackground(ra, global_background_color);
+      draw_processes(&context);
+      draw_info_panel(&context);
 
-    BeginDrawing();
-    render_Commands(ra);
-    context.render_arena.Offset = 0;
-    EndDrawing();
+      BeginDrawing();
+      render_Commands(ra);
+      context.render_arena.Offset = 0;
+      EndDrawing();
+      needs_redraw = 0;
+    } else {
+      // NOTE: Nothing has changed, so the last frame is still on screen. Rather than drawing it again, sleep until the next input event wakes us up, and check that event on the next pass.
+      EnableEventWaiting();
+      PollInputEvents();
+      DisableEventWaiting();
+    }
   }
 
+  render_UnloadBackend();
   CloseWindow();
   return 0;
 }
+#endif // Proc_Bench
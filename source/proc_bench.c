@@ -0,0 +1,935 @@
+/*
+   Micro-benchmarks for the data-structures in proc.c.
+
+   Build with "./build.sh proc_bench" and run "build/proc_bench.out". Set GO_FAST=1 in build.sh to get meaningful numbers.
+
+   NOTE: This includes proc.c directly (minus its main), so every benchmark runs against the same code as the app.
+*/
+
+#define Proc_Bench 1
+#include "../source/proc.c"
+
+#include <time.h>
+#include <stdlib.h>
+
+
+
+function F64 bench_get_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  F64 seconds = (F64)ts.tv_sec + 1e-9*(F64)ts.tv_nsec;
+  return seconds;
+}
+
+
+function void bench_print(const char *name, F64 seconds, U64 op_count) {
+  F64 ns_per_op = op_count ? (1e9*seconds / (F64)op_count) : 0.0;
+  printf("  %-40s %10.3f ms  %12llu ops  %8.2f ns/op\n", name, 1e3*seconds, (unsigned long long)op_count, ns_per_op);
+}
+
+
+/*
+  Contexts reserve a lot of address space, so release each one when a benchmark is done with it, otherwise later benchmarks pay for the earlier ones.
+*/
+function void bench_free_context(Context *context) {
+  FreeArena(context->render_arena);
+  FreeArena(context->process_arena);
+  FreeArena(context->wire_arena);
+  FreeArena(context->edge_arena);
+  FreeArena(context->label_arena);
+  FreeArena(context->shape_arena);
+  FreeArena(context->port_arena);
+  FreeArena(context->grid_arena);
+  FreeArena(context->spatial_dirty_arena);
+  FreeArena(context->scene_arena);
+  FreeArena(context->wire_curve_arena);
+  FreeArena(context->temp_arena);
+}
+
+
+function void bench_print_throughput(const char *name, F64 seconds, U64 element_count) {
+  F64 elements_per_second = seconds > 0.0 ? ((F64)element_count / seconds) : 0.0;
+  printf("  %-40s %10.3f ms  %12llu elements  %8.2f M elements/s\n", name, 1e3*seconds, (unsigned long long)element_count, 1e-6*elements_per_second);
+}
+
+
+
+
+////////////////
+//  Process allocation
+////////////////
+#define Bench_Churn_Iterations 1000000
+#define Bench_Live_Process_Count 4000
+#define Bench_Refill_Rounds 256
+
+function void bench_process_allocation(void) {
+  printf("process allocation\n");
+
+  {
+    // create two processes, connect them, then delete them both (deleting the first also deletes the wire)
+    Context context = initialize_context();
+    U64 op_count = 0;
+
+    F64 start = bench_get_seconds();
+    for (S32 i = 0; i < Bench_Churn_Iterations; ++i) {
+      Process *a = create_process(&context);
+      Process *b = create_process(&context);
+      connect_processes(&context, a, b);
+      delete_process(&context, a);
+      delete_process(&context, b);
+      op_count += 6;
+    }
+    F64 seconds = bench_get_seconds() - start;
+
+    bench_print("create/connect/delete churn", seconds, op_count);
+    bench_free_context(&context);
+  }
+
+  {
+    // refill holes left in a diagram that has many live processes
+    Context context = initialize_context();
+    arena *pa = &context.process_arena;
+    for (S32 i = 0; i < Bench_Live_Process_Count; ++i) {
+      create_process(&context);
+    }
+
+    F64 seconds = 0.0;
+    U64 op_count = 0;
+    for (S32 round = 0; round < Bench_Refill_Rounds; ++round) {
+      for (S32 i = 2; i <= Bench_Live_Process_Count; i += 2) {
+        free_process(&context, Get_Process_Slot(pa, i));
+      }
+
+      F64 start = bench_get_seconds();
+      for (S32 i = 2; i <= Bench_Live_Process_Count; i += 2) {
+        create_process(&context);
+        op_count += 1;
+      }
+      seconds += bench_get_seconds() - start;
+    }
+
+    bench_print("create into fragmented arena", seconds, op_count);
+    bench_free_context(&context);
+  }
+}
+
+
+
+
+////////////////
+//  Frame time
+////////////////
+#define Bench_Frame_Count 10
+#define Bench_Grid_Width 256
+
+/*
+  Builds a grid of processes where each process is wired to its neighbour, so half of the elements are processes and half are wires.
+*/
+function void bench_build_grid_diagram(Context *context, S32 element_count) {
+  Process *previous = 0;
+
+  for (S32 i = 0; i < element_count/2; ++i) {
+    Process *p = create_process(context);
+    if (p) {
+      p->position.x = 60.0f * (F32)(i % Bench_Grid_Width);
+      p->position.y = 80.0f * (F32)(i / Bench_Grid_Width);
+      if (previous) {
+        connect_processes(context, previous, p);
+      }
+    }
+    previous = p;
+  }
+}
+
+
+function void bench_frame_time(S32 element_count) {
+  Context context = initialize_context();
+  bench_build_grid_diagram(&context, element_count);
+
+  // NOTE: warm up, so the first touches of the arena pages are not measured
+  handle_user_input(&context);
+  draw_processes(&context);
+  U64 command_bytes = context.render_arena.Offset;
+  context.render_arena.Offset = 0;
+
+  F64 start = bench_get_seconds();
+  for (S32 i = 0; i < Bench_Frame_Count; ++i) {
+    handle_user_input(&context);
+    draw_processes(&context);
+    context.render_arena.Offset = 0;
+  }
+  F64 seconds = (bench_get_seconds() - start) / (F64)Bench_Frame_Count;
+
+  char name[64];
+  snprintf(name, sizeof(name), "frame with %d elements", element_count);
+  bench_print(name, seconds, element_count);
+  printf("  %-40s %10llu bytes of render commands\n", "", (unsigned long long)command_bytes);
+  bench_free_context(&context);
+}
+
+
+/*
+  Batching the commands of one frame. Every change of kind in the submitted order can break raylib's own batching, so count those before and after. The commands are pushed in layer order, so they are batched without sorting, and then once more with the process layer sorted by kind to see what the sort costs.
+*/
+function void bench_command_batching(S32 element_count) {
+  Context context = initialize_context();
+  arena *ra = &context.render_arena;
+  arena *ta = &context.temp_arena;
+  bench_build_grid_diagram(&context, element_count);
+
+  // NOTE: label every process and hover the first one, so the frame has strokes, labels and boxes interleaved like a real one
+  for (S32 i = 1; i <= Get_Process_Count(&context.process_arena); ++i) {
+    push_label_char(&context, Get_Process_Slot(&context.process_arena, i), 'f');
+  }
+  context.hot_id = Get_Process_Id(&context.process_arena, Get_Process_Slot(&context.process_arena, 1));
+  draw_processes(&context);
+
+  S32 command_count = 0;
+  S32 pushed_change_count = 0;
+  render_command_header *previous = 0;
+  for (U8 *at = ra->Data; at < ra->Data + ra->Offset; at += ((render_command_header *)at)->Size) {
+    render_command_header *header = (render_command_header *)at;
+    pushed_change_count += previous && previous->Kind != header->Kind;
+    previous = header;
+    command_count += 1;
+  }
+
+  for (S32 sorted = 0; sorted <= 1; ++sorted) {
+    GlobalRenderSortedLayers = sorted ? (1u << Draw_Layer_Process) : 0;
+
+    S32 batch_count = 0;
+    render_batch *batches = 0;
+    F64 start = bench_get_seconds();
+    for (S32 i = 0; i < Bench_Frame_Count; ++i) {
+      ryn_memory_BeginArena(ta);
+      batches = render_BatchCommands(ra, ta, &batch_count);
+      ryn_memory_EndArena(ta);
+    }
+    F64 seconds = (bench_get_seconds() - start) / (F64)Bench_Frame_Count;
+
+    // NOTE: the last batches were popped, but nothing has been pushed over them since
+    S32 batched_change_count = 0;
+    for (S32 i = 1; i < batch_count; ++i) {
+      batched_change_count += batches[i].First->Kind != batches[i-1].First->Kind;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "%s %d elements", sorted ? "sort and batch" : "batch", element_count);
+    bench_print(name, seconds, command_count);
+    printf("  (%d commands in %d batches, %d kind changes before, %d after)\n",
+           command_count, batch_count, pushed_change_count, batched_change_count);
+  }
+
+  GlobalRenderSortedLayers = 0;
+  bench_free_context(&context);
+}
+
+
+/*
+  Submitting one frame's commands, through raylib's shape functions and through the rlgl backend. This needs a graphics context, so the caller opens a hidden window. Only the CPU side is measured: building the vertices and flushing them to the GPU, not the GPU drawing them.
+*/
+function void bench_render_submission(S32 element_count) {
+  Context context = initialize_context();
+  arena *ra = &context.render_arena;
+  render_Initialize(&context.temp_arena);
+  bench_build_grid_diagram(&context, element_count);
+  draw_processes(&context);
+
+  S32 command_count = 0;
+  for (U8 *at = ra->Data; at < ra->Data + ra->Offset; at += ((render_command_header *)at)->Size) {
+    command_count += 1;
+  }
+
+  const char *backend_names[] = {"raylib", "rlgl"};
+
+  for (S32 backend = render_backend_Raylib; backend <= render_backend_Rlgl; ++backend) {
+    GlobalRenderBackend = (render_backend)backend;
+
+    // NOTE: warm up, so buffers and the driver have settled before measuring
+    BeginDrawing();
+    render_Commands(ra);
+    EndDrawing();
+
+    F64 seconds = 0.0;
+    for (S32 i = 0; i < Bench_Frame_Count; ++i) {
+      BeginDrawing();
+      F64 start = bench_get_seconds();
+      render_Commands(ra);
+      rlDrawRenderBatchActive();
+      seconds += bench_get_seconds() - start;
+      EndDrawing();
+    }
+    seconds /= (F64)Bench_Frame_Count;
+
+    char name[64];
+    snprintf(name, sizeof(name), "%s, %d commands", backend_names[backend], command_count);
+    bench_print(name, seconds, command_count);
+  }
+
+  // NOTE: back to the backend that was loaded, so render_UnloadBackend frees its batch
+  GlobalRenderBackend = render_backend_Rlgl;
+  bench_free_context(&context);
+}
+
+
+
+
+////////////////
+//  Hover
+////////////////
+#define Bench_Hover_Query_Count 1000
+
+/*
+  Hit-tests random mouse positions over a grid diagram, once through the spatial grid and once by testing every process like handle_user_input used to. Picking wire bodies is timed on its own.
+*/
+function void bench_hover(S32 element_count) {
+  Context context = initialize_context();
+  arena *pa = &context.process_arena;
+  arena *ta = &context.temp_arena;
+  bench_build_grid_diagram(&context, element_count);
+  update_spatial_indices(&context);
+
+  S32 process_count = element_count/2;
+  F32 width = 60.0f * (F32)Bench_Grid_Width;
+  F32 height = 80.0f * (F32)(process_count / Bench_Grid_Width + 1);
+  Vector2 points[Bench_Hover_Query_Count];
+  srand(1);
+  for (S32 i = 0; i < Bench_Hover_Query_Count; ++i) {
+    points[i].x = width * (F32)rand() / (F32)RAND_MAX;
+    points[i].y = height * (F32)rand() / (F32)RAND_MAX;
+  }
+
+  U64 hit_count = 0;
+  F64 start = bench_get_seconds();
+  for (S32 i = 0; i < Bench_Hover_Query_Count; ++i) {
+    ryn_memory_BeginArena(ta);
+    context.mouse_position = points[i];
+
+    S32 candidate_count = 0;
+    U32 *candidates = query_process_grid(&context, points[i], &candidate_count);
+    for (S32 j = 0; j < candidate_count; ++j) {
+      Process_Selection selection = handle_process_selection(&context, Get_Process_Slot(pa, candidates[j]));
+      hit_count += selection.type != 0;
+    }
+
+    ryn_memory_EndArena(ta);
+  }
+  F64 grid_seconds = bench_get_seconds() - start;
+
+  start = bench_get_seconds();
+  for (S32 i = 0; i < Bench_Hover_Query_Count; ++i) {
+    hit_count += pick_wire(&context, points[i]) != 0;
+  }
+  F64 pick_seconds = bench_get_seconds() - start;
+
+  // NOTE: The linear scan is slow on big diagrams, so only a tenth of the queries are run through it.
+  S32 linear_query_count = Bench_Hover_Query_Count / 10;
+  S32 pc = Get_Process_Count(pa);
+  start = bench_get_seconds();
+  for (S32 i = 0; i < linear_query_count; ++i) {
+    context.mouse_position = points[i];
+
+    for (S32 j = 1; j <= pc; ++j) {
+      Process *p = Get_Process_Slot(pa, j);
+      if (!Get_Flag(p->flags, Process_Flag_Deleted)) {
+        Process_Selection selection = handle_process_selection(&context, p);
+        hit_count += selection.type != 0;
+      }
+    }
+  }
+  F64 linear_seconds = bench_get_seconds() - start;
+
+  char name[64];
+  snprintf(name, sizeof(name), "grid hover, %d elements", element_count);
+  bench_print(name, grid_seconds, Bench_Hover_Query_Count);
+  snprintf(name, sizeof(name), "wire pick, %d elements", element_count);
+  bench_print(name, pick_seconds, Bench_Hover_Query_Count);
+  snprintf(name, sizeof(name), "linear hover, %d elements", element_count);
+  bench_print(name, linear_seconds, linear_query_count);
+
+  bench_free_context(&context);
+}
+
+
+
+
+////////////////
+//  Orientation
+////////////////
+#define Bench_Orient_Count 1000000
+
+/*
+  Random points are almost never near the line, so orient_2d should stay on its float path. Points exactly on the line always take the exact path, which bounds the worst case.
+*/
+function void bench_orientation(void) {
+  arena bench_arena = CreateGrowableArena(Gigabytes(1));
+  Vector2 *random_points = ryn_memory_PushZeroArray(&bench_arena, Vector2, Bench_Orient_Count);
+  Vector2 *line_points = ryn_memory_PushZeroArray(&bench_arena, Vector2, Bench_Orient_Count);
+  Vector2 a = (Vector2){10.5f, 20.25f};
+  Vector2 b = (Vector2){810.5f, 620.25f};
+
+  srand(1);
+  for (S32 i = 0; i < Bench_Orient_Count; ++i) {
+    random_points[i].x = 1000.0f * (F32)rand() / (F32)RAND_MAX;
+    random_points[i].y = 1000.0f * (F32)rand() / (F32)RAND_MAX;
+    F32 t = (F32)(rand() % 64) / 64.0f;
+    line_points[i] = (Vector2){a.x + t*(b.x - a.x), a.y + t*(b.y - a.y)};
+  }
+
+  U64 negative_count = 0;
+  F64 start = bench_get_seconds();
+  for (S32 i = 0; i < Bench_Orient_Count; ++i) {
+    negative_count += which_side_of_line(a, b, random_points[i]) < 0.0f;
+  }
+  F64 seconds = bench_get_seconds() - start;
+  bench_print("which_side_of_line, random points", seconds, Bench_Orient_Count);
+
+  start = bench_get_seconds();
+  for (S32 i = 0; i < Bench_Orient_Count; ++i) {
+    negative_count += orient_2d(a, b, random_points[i]) < 0.0f;
+  }
+  seconds = bench_get_seconds() - start;
+  bench_print("orient_2d, random points", seconds, Bench_Orient_Count);
+
+  start = bench_get_seconds();
+  for (S32 i = 0; i < Bench_Orient_Count; ++i) {
+    negative_count += orient_2d(a, b, line_points[i]) < 0.0f;
+  }
+  seconds = bench_get_seconds() - start;
+  bench_print("orient_2d, points on the line", seconds, Bench_Orient_Count);
+
+  printf("  (%llu negative)\n", (unsigned long long)negative_count);
+  FreeArena(bench_arena);
+}
+
+
+
+
+////////////////
+//  Batched point-in-shape
+////////////////
+#define Bench_Shape_Count 10000
+#define Bench_Shape_Point_Count 100
+#define Bench_Fan_Point_Count 100000
+
+function void bench_point_in_shape(B32 rounded_shapes) {
+  Context context = initialize_context();
+  arena *pa = &context.process_arena;
+  if (rounded_shapes) {
+    Set_Flag(context.flags, Context_Flag_RoundedShapes);
+  }
+  bench_build_grid_diagram(&context, 2*Bench_Shape_Count);
+
+  arena bench_arena = CreateGrowableArena(Gigabytes(1));
+  Process_Shape **shapes = ryn_memory_PushArray(&bench_arena, Process_Shape *, Bench_Shape_Count);
+  B32 *results = ryn_memory_PushArray(&bench_arena, B32, Bench_Fan_Point_Count);
+  Vector2 *points = ryn_memory_PushArray(&bench_arena, Vector2, Bench_Fan_Point_Count);
+  for (S32 i = 0; i < Bench_Shape_Count; ++i) {
+    shapes[i] = get_process_shape(&context, Get_Process_Slot(pa, i + 1));
+  }
+
+  srand(1);
+  F32 width = 60.0f * (F32)Bench_Grid_Width;
+  F32 height = 80.0f * (F32)(Bench_Shape_Count / Bench_Grid_Width + 1);
+  for (S32 i = 0; i < Bench_Fan_Point_Count; ++i) {
+    points[i].x = width * (F32)rand() / (F32)RAND_MAX;
+    points[i].y = height * (F32)rand() / (F32)RAND_MAX;
+  }
+
+  const char *kind = rounded_shapes ? "rounded" : "angular";
+  char name[64];
+  U64 hit_count = 0;
+
+  // one point against every shape
+  F64 start = bench_get_seconds();
+  for (S32 i = 0; i < Bench_Shape_Point_Count; ++i) {
+    for (S32 j = 0; j < Bench_Shape_Count; ++j) {
+      hit_count += process_shape_contains_point(&context, shapes[j], points[i]);
+    }
+  }
+  F64 seconds = bench_get_seconds() - start;
+  snprintf(name, sizeof(name), "scalar point vs %d %s shapes", Bench_Shape_Count, kind);
+  bench_print(name, seconds, (U64)Bench_Shape_Point_Count*Bench_Shape_Count);
+
+  start = bench_get_seconds();
+  Process_Shape_Batch batch = build_process_shape_batch(&bench_arena, shapes, Bench_Shape_Count);
+  seconds = bench_get_seconds() - start;
+  snprintf(name, sizeof(name), "batch %d %s shapes", Bench_Shape_Count, kind);
+  bench_print(name, seconds, Bench_Shape_Count);
+
+  start = bench_get_seconds();
+  for (S32 i = 0; i < Bench_Shape_Point_Count; ++i) {
+    process_shape_batch_contains_point(&batch, points[i], results);
+    for (S32 j = 0; j < Bench_Shape_Count; ++j) {
+      hit_count += results[j];
+    }
+  }
+  seconds = bench_get_seconds() - start;
+  snprintf(name, sizeof(name), "batched point vs %d %s shapes", Bench_Shape_Count, kind);
+  bench_print(name, seconds, (U64)Bench_Shape_Point_Count*Bench_Shape_Count);
+
+  // NOTE: the batch skips shapes by their bounds, so check that it still agrees with the scalar test everywhere
+  U64 mismatch_count = 0;
+  for (S32 i = 0; i < Bench_Shape_Point_Count; ++i) {
+    process_shape_batch_contains_point(&batch, points[i], results);
+    for (S32 j = 0; j < Bench_Shape_Count; ++j) {
+      mismatch_count += results[j] != process_shape_contains_point(&context, shapes[j], points[i]);
+    }
+  }
+  printf("  (%llu mismatches against the scalar test)\n", (unsigned long long)mismatch_count);
+
+  if (rounded_shapes) {
+    // many points against one half-circle fan
+    Process_Shape *fan = 0;
+    for (S32 i = 0; i < Bench_Shape_Count && !fan; ++i) {
+      fan = shapes[i]->kind == Process_Shape_HalfCircle ? shapes[i] : 0;
+    }
+
+    if (fan) {
+      Vector2 origin = points[0];
+      for (S32 i = 0; i < Bench_Fan_Point_Count; ++i) {
+        // NOTE: Crowd the points around the fan, so about half of them land inside.
+        points[i] = Vector2Add(fan->center, Vector2Scale(Vector2Subtract(points[i], origin), 40.0f / width));
+      }
+
+      start = bench_get_seconds();
+      for (S32 i = 0; i < Bench_Fan_Point_Count; ++i) {
+        hit_count += triangle_fan_contains_point(fan->points, fan->triangle_count, points[i]);
+      }
+      seconds = bench_get_seconds() - start;
+      bench_print("scalar points vs one fan", seconds, Bench_Fan_Point_Count);
+
+      start = bench_get_seconds();
+      triangle_fan_contains_points(fan->points, fan->triangle_count, points, Bench_Fan_Point_Count, results);
+      for (S32 i = 0; i < Bench_Fan_Point_Count; ++i) {
+        hit_count += results[i];
+      }
+      seconds = bench_get_seconds() - start;
+      bench_print("batched points vs one fan", seconds, Bench_Fan_Point_Count);
+    }
+  }
+
+  printf("  (%llu hits)\n", (unsigned long long)hit_count);
+  FreeArena(bench_arena);
+  bench_free_context(&context);
+}
+
+
+
+
+////////////////
+//  Side of curve
+////////////////
+#define Bench_Curve_Point_Count 100000
+#define Bench_Curve_Count 64
+
+/*
+  Tests points against many wire-like curves, a chunk of points per curve, so the coefficients can't be hoisted out of the loop.
+*/
+function void bench_side_of_curve(void) {
+  arena bench_arena = CreateGrowableArena(Gigabytes(1));
+  Vector2 *points = ryn_memory_PushZeroArray(&bench_arena, Vector2, Bench_Curve_Point_Count);
+  F32 *sides = ryn_memory_PushZeroArray(&bench_arena, F32, Bench_Curve_Point_Count);
+  Wire_Curve curves[Bench_Curve_Count];
+  Implicit_Bezier implicits[Bench_Curve_Count];
+  S32 chunk_size = Bench_Curve_Point_Count / Bench_Curve_Count;
+
+  srand(1);
+  for (S32 c = 0; c < Bench_Curve_Count; ++c) {
+    curves[c].out_position = (Vector2){100.0f + (F32)(rand() % 100), 100.0f + (F32)(rand() % 100)};
+    curves[c].in_position = (Vector2){300.0f + (F32)(rand() % 100), 400.0f + (F32)(rand() % 100)};
+    curves[c].out_control = (Vector2){curves[c].out_position.x, curves[c].out_position.y - Wire_Control_Offset};
+    curves[c].in_control = (Vector2){curves[c].in_position.x, curves[c].in_position.y + Wire_Control_Offset};
+  }
+  for (S32 i = 0; i < Bench_Curve_Point_Count; ++i) {
+    points[i].x = 100.0f + 300.0f * (F32)rand() / (F32)RAND_MAX;
+    points[i].y = 100.0f + 400.0f * (F32)rand() / (F32)RAND_MAX;
+  }
+
+  S32 point_count = chunk_size * Bench_Curve_Count;
+  U64 negative_count = 0;
+  F64 start = bench_get_seconds();
+  for (S32 i = 0; i < point_count; ++i) {
+    Wire_Curve *curve = curves + i / chunk_size;
+    negative_count += which_side_of_bezier(curve->out_position, curve->in_position, curve->out_control, curve->in_control, points[i]) < 0.0f;
+  }
+  F64 seconds = bench_get_seconds() - start;
+  bench_print("which_side_of_bezier", seconds, point_count);
+
+  for (S32 c = 0; c < Bench_Curve_Count; ++c) {
+    implicits[c] = get_implicit_bezier(curves[c].out_position, curves[c].in_position, curves[c].out_control, curves[c].in_control);
+  }
+
+  start = bench_get_seconds();
+  for (S32 i = 0; i < point_count; ++i) {
+    negative_count += evaluate_implicit_bezier(implicits + i / chunk_size, points[i]) < 0.0f;
+  }
+  seconds = bench_get_seconds() - start;
+  bench_print("cached coefficients", seconds, point_count);
+
+  start = bench_get_seconds();
+  for (S32 c = 0; c < Bench_Curve_Count; ++c) {
+    evaluate_implicit_bezier_points(implicits + c, points + c*chunk_size, chunk_size, sides + c*chunk_size);
+  }
+  for (S32 i = 0; i < point_count; ++i) {
+    negative_count += sides[i] < 0.0f;
+  }
+  seconds = bench_get_seconds() - start;
+  bench_print("cached coefficients, batched", seconds, point_count);
+
+  printf("  (%llu negative)\n", (unsigned long long)negative_count);
+  FreeArena(bench_arena);
+}
+
+
+
+
+////////////////
+//  Curve tessellation
+////////////////
+#define Bench_Tessellation_Curve_Count 100000
+#define Bench_Flatness_Sample_Count 8
+
+/*
+  Checks that flattened curves stay within tolerance of the real ones. Every segment is compared against the curve at a few points between its ends, so this finds the sampled maximum distance, not the exact one. Curves that hit Wire_Max_Segment_Count are not held to the tolerance, so they are counted on their own.
+*/
+function void bench_check_flatness(Wire_Curve *curves, S32 curve_count, F32 tolerance, Vector2 *points) {
+  F32 max_distance_squared = 0.0f;
+  S32 over_count = 0;
+  S32 capped_count = 0;
+
+  for (S32 c = 0; c < curve_count; ++c) {
+    Wire_Curve *curve = curves + c;
+    S32 segment_count = get_wire_segment_count(curve, tolerance);
+    F32 curve_distance_squared = 0.0f;
+    get_bezier_points(curve->out_position, curve->in_position, curve->out_control, curve->in_control, segment_count, points);
+
+    for (S32 i = 0; i < segment_count; ++i) {
+      for (S32 j = 1; j < Bench_Flatness_Sample_Count; ++j) {
+        F32 t = ((F32)i + (F32)j / (F32)Bench_Flatness_Sample_Count) / (F32)segment_count;
+        Vector2 point = get_bezier_point(curve->out_position, curve->in_position, curve->out_control, curve->in_control, t);
+        curve_distance_squared = Max(curve_distance_squared, get_distance_to_segment_squared(points[i], points[i+1], point));
+      }
+    }
+
+    if (segment_count == Wire_Max_Segment_Count) {
+      capped_count += 1;
+    } else {
+      max_distance_squared = Max(max_distance_squared, curve_distance_squared);
+      over_count += curve_distance_squared > tolerance*tolerance;
+    }
+  }
+
+  printf("  (max distance from the curve %.3f, tolerance %.3f, %d over, %d capped)\n",
+         sqrtf(max_distance_squared), tolerance, over_count, capped_count);
+}
+
+/*
+  Tessellates many curves one point at a time, the way fans and wires used to be built, and then all at once with get_bezier_points. 13 segments has a basis table and 24 (raylib's spline resolution) does not, so it shows the cost of computing the basis on the fly.
+
+  Then flattens them the way wires are, with as many segments as each needs, to compare the point count against raylib's fixed 24 segments, and checks that the result stays within Wire_Flatness_Tolerance.
+*/
+function void bench_curve_tessellation(void) {
+  arena bench_arena = CreateGrowableArena(Gigabytes(1));
+  Wire_Curve *curves = ryn_memory_PushZeroArray(&bench_arena, Wire_Curve, Bench_Tessellation_Curve_Count);
+  Vector2 *points = ryn_memory_PushZeroArray(&bench_arena, Vector2, Wire_Max_Segment_Count+1);
+  S32 segment_counts[2] = {13, 24};
+  char name[64];
+
+  srand(1);
+  for (S32 c = 0; c < Bench_Tessellation_Curve_Count; ++c) {
+    curves[c].out_position = (Vector2){(F32)(rand() % 1000), (F32)(rand() % 1000)};
+    curves[c].in_position = (Vector2){(F32)(rand() % 1000), (F32)(rand() % 1000)};
+    curves[c].out_control = (Vector2){curves[c].out_position.x, curves[c].out_position.y - Wire_Control_Offset};
+    curves[c].in_control = (Vector2){curves[c].in_position.x, curves[c].in_position.y + Wire_Control_Offset};
+  }
+
+  for (S32 k = 0; k < 2; ++k) {
+    S32 segment_count = segment_counts[k];
+    U64 point_count = (U64)Bench_Tessellation_Curve_Count*(segment_count+1);
+    F32 checksum = 0.0f;
+
+    F64 start = bench_get_seconds();
+    for (S32 c = 0; c < Bench_Tessellation_Curve_Count; ++c) {
+      Wire_Curve *curve = curves + c;
+      points[0] = curve->out_position;
+      for (S32 i = 1; i < segment_count; ++i) {
+        F32 t = (F32)i / (F32)segment_count;
+        points[i] = get_bezier_point(curve->out_position, curve->in_position, curve->out_control, curve->in_control, t);
+      }
+      points[segment_count] = curve->in_position;
+      checksum += points[c % (segment_count+1)].x;
+    }
+    F64 seconds = bench_get_seconds() - start;
+    snprintf(name, sizeof(name), "get_bezier_point, %d segments", segment_count);
+    bench_print(name, seconds, point_count);
+
+    start = bench_get_seconds();
+    for (S32 c = 0; c < Bench_Tessellation_Curve_Count; ++c) {
+      Wire_Curve *curve = curves + c;
+      get_bezier_points(curve->out_position, curve->in_position, curve->out_control, curve->in_control, segment_count, points);
+      checksum += points[c % (segment_count+1)].x;
+    }
+    seconds = bench_get_seconds() - start;
+    snprintf(name, sizeof(name), "get_bezier_points, %d segments%s", segment_count, get_bezier_basis(segment_count) ? "" : " (no table)");
+    bench_print(name, seconds, point_count);
+    printf("  (checksum %.1f)\n", checksum);
+  }
+
+  for (S32 k = 0; k < 2; ++k) {
+    F32 zoom = k ? 4.0f : 1.0f;
+    U64 point_count = 0;
+    F32 checksum = 0.0f;
+
+    F64 start = bench_get_seconds();
+    for (S32 c = 0; c < Bench_Tessellation_Curve_Count; ++c) {
+      Wire_Curve *curve = curves + c;
+      S32 segment_count = get_wire_segment_count(curve, Wire_Flatness_Tolerance / zoom);
+      get_bezier_points(curve->out_position, curve->in_position, curve->out_control, curve->in_control, segment_count, points);
+      point_count += segment_count+1;
+      checksum += points[c % (segment_count+1)].x;
+    }
+    F64 seconds = bench_get_seconds() - start;
+    snprintf(name, sizeof(name), "adaptive at zoom %.0f", zoom);
+    bench_print(name, seconds, point_count);
+    printf("  (%.1f points per curve, checksum %.1f)\n", (F64)point_count / Bench_Tessellation_Curve_Count, checksum);
+    bench_check_flatness(curves, Bench_Tessellation_Curve_Count, Wire_Flatness_Tolerance / zoom, points);
+  }
+
+  FreeArena(bench_arena);
+}
+
+
+
+
+////////////////
+//  Region queries
+////////////////
+#define Bench_Region_Query_Count 200
+#define Bench_Drag_Step_Count 1000
+
+/*
+  Tests every process and wire against the region, like a box-selection without the scene-tree would.
+*/
+function S32 bench_linear_region_query(Context *context, Rectangle box, Vector2 *polygon, S32 polygon_count) {
+  arena *pa = &context->process_arena;
+  arena *wa = &context->wire_arena;
+  S32 hit_count = 0;
+
+  for (S32 i = 1; i <= (S32)Get_Process_Count(pa); ++i) {
+    if (!Get_Flag(Get_Process_Slot(pa, i)->flags, Process_Flag_Deleted)) {
+      hit_count += scene_item_overlaps_region(context, i, box, polygon, polygon_count);
+    }
+  }
+  for (S32 i = 1; i <= (S32)Get_Wire_Count(wa); ++i) {
+    if (!Wire_Is_Deleted(Get_Wire_Slot(wa, i))) {
+      hit_count += scene_item_overlaps_region(context, i | Scene_Item_Wire_Bit, box, polygon, polygon_count);
+    }
+  }
+
+  return hit_count;
+}
+
+
+function void bench_region_queries(S32 element_count, F32 query_size) {
+  Context context = initialize_context();
+  arena *pa = &context.process_arena;
+  arena *ta = &context.temp_arena;
+  bench_build_grid_diagram(&context, element_count);
+
+  char name[64];
+  F64 start = bench_get_seconds();
+  update_spatial_indices(&context);
+  F64 seconds = bench_get_seconds() - start;
+  snprintf(name, sizeof(name), "index %d elements", element_count);
+  bench_print_throughput(name, seconds, element_count);
+
+  // drag one process around in small steps, refitting it and its wires every step
+  Process *dragged = Get_Process_Slot(pa, 1 + Get_Process_Count(pa)/2);
+  Vector2 origin = dragged->position;
+  start = bench_get_seconds();
+  for (S32 i = 0; i < Bench_Drag_Step_Count; ++i) {
+    Vector2 position = (Vector2){origin.x + (F32)(i % 100), origin.y + 0.5f*(F32)(i % 40)};
+    set_process_position(&context, dragged, position);
+    update_spatial_indices(&context);
+  }
+  seconds = bench_get_seconds() - start;
+  bench_print("drag refit", seconds, Bench_Drag_Step_Count);
+
+  S32 process_count = element_count/2;
+  F32 width = 60.0f * (F32)Bench_Grid_Width;
+  F32 height = 80.0f * (F32)(process_count / Bench_Grid_Width + 1);
+  Rectangle boxes[Bench_Region_Query_Count];
+  Vector2 lassos[Bench_Region_Query_Count][8];
+  srand(1);
+  for (S32 i = 0; i < Bench_Region_Query_Count; ++i) {
+    Vector2 center = (Vector2){width * (F32)rand() / (F32)RAND_MAX, height * (F32)rand() / (F32)RAND_MAX};
+    boxes[i] = (Rectangle){center.x - 0.5f*query_size, center.y - 0.5f*query_size, query_size, query_size};
+    for (S32 k = 0; k < 8; ++k) {
+      // an eight-pointed star, so the lasso is not convex
+      F32 angle = (F32)k * (2.0f*PI / 8.0f);
+      F32 radius = (k & 1) ? 0.25f*query_size : 0.5f*query_size;
+      lassos[i][k] = (Vector2){center.x + radius*cosf(angle), center.y + radius*sinf(angle)};
+    }
+  }
+
+  U64 hit_count = 0;
+  start = bench_get_seconds();
+  for (S32 i = 0; i < Bench_Region_Query_Count; ++i) {
+    ryn_memory_BeginArena(ta);
+    Scene_Query query = query_scene_rectangle(&context, boxes[i]);
+    hit_count += query.process_count + query.wire_count;
+    ryn_memory_EndArena(ta);
+  }
+  seconds = bench_get_seconds() - start;
+  snprintf(name, sizeof(name), "tree rectangle %.0fpx", query_size);
+  bench_print(name, seconds, Bench_Region_Query_Count);
+
+  start = bench_get_seconds();
+  for (S32 i = 0; i < Bench_Region_Query_Count; ++i) {
+    ryn_memory_BeginArena(ta);
+    Scene_Query query = query_scene_polygon(&context, lassos[i], 8);
+    hit_count += query.process_count + query.wire_count;
+    ryn_memory_EndArena(ta);
+  }
+  seconds = bench_get_seconds() - start;
+  snprintf(name, sizeof(name), "tree lasso %.0fpx", query_size);
+  bench_print(name, seconds, Bench_Region_Query_Count);
+
+  // NOTE: The linear scan is slow on big diagrams, so only a tenth of the queries are run through it.
+  S32 linear_query_count = Bench_Region_Query_Count / 10;
+  start = bench_get_seconds();
+  for (S32 i = 0; i < linear_query_count; ++i) {
+    hit_count += bench_linear_region_query(&context, boxes[i], 0, 0);
+  }
+  seconds = bench_get_seconds() - start;
+  snprintf(name, sizeof(name), "linear rectangle %.0fpx", query_size);
+  bench_print(name, seconds, linear_query_count);
+
+  start = bench_get_seconds();
+  for (S32 i = 0; i < linear_query_count; ++i) {
+    hit_count += bench_linear_region_query(&context, get_points_bounds(lassos[i], 8), lassos[i], 8);
+  }
+  seconds = bench_get_seconds() - start;
+  snprintf(name, sizeof(name), "linear lasso %.0fpx", query_size);
+  bench_print(name, seconds, linear_query_count);
+
+  // NOTE: Print the hits so the queries can't be optimized away.
+  printf("  (%llu hits)\n", (unsigned long long)hit_count);
+  bench_free_context(&context);
+}
+
+
+
+
+////////////////
+//  Bulk construction
+////////////////
+/*
+  A circuit-like diagram: every process takes its inputs from the fan_in processes before it and from the process one grid-row up. With a large fan_in, building one wire at a time keeps outgrowing the wire-lists, while build_diagram sizes them once.
+*/
+function void bench_bulk_construction(S32 process_count, S32 fan_in) {
+  arena bench_arena = CreateGrowableArena(Gigabytes(1));
+  Process_Desc *processes = ryn_memory_PushArray(&bench_arena, Process_Desc, process_count);
+  Wire_Desc *wires = ryn_memory_PushArray(&bench_arena, Wire_Desc, (fan_in+1)*process_count);
+  S32 wire_count = 0;
+
+  for (S32 i = 0; i < process_count; ++i) {
+    processes[i] = (Process_Desc){0};
+    processes[i].position.x = 60.0f * (F32)(i % Bench_Grid_Width);
+    processes[i].position.y = 80.0f * (F32)(i / Bench_Grid_Width);
+
+    for (S32 k = 1; k <= fan_in && k <= i; ++k) {
+      wires[wire_count++] = (Wire_Desc){ .out_process = i-k, .in_process = i };
+    }
+    if (i >= Bench_Grid_Width) {
+      wires[wire_count++] = (Wire_Desc){ .out_process = i-Bench_Grid_Width, .in_process = i };
+    }
+  }
+
+  U64 element_count = process_count + wire_count;
+  char name[64];
+
+  {
+    Context context = initialize_context();
+    Process **created = ryn_memory_PushArray(&bench_arena, Process *, process_count);
+
+    F64 start = bench_get_seconds();
+    for (S32 i = 0; i < process_count; ++i) {
+      created[i] = create_process(&context);
+      created[i]->position = processes[i].position;
+    }
+    for (S32 i = 0; i < wire_count; ++i) {
+      connect_processes(&context, created[wires[i].out_process], created[wires[i].in_process]);
+    }
+    F64 seconds = bench_get_seconds() - start;
+
+    snprintf(name, sizeof(name), "one at a time, %d x %d fan-in", process_count, fan_in);
+    bench_print_throughput(name, seconds, element_count);
+    bench_free_context(&context);
+  }
+
+  {
+    Context context = initialize_context();
+
+    F64 start = bench_get_seconds();
+    B32 built = build_diagram(&context, processes, process_count, wires, wire_count, 0);
+    F64 seconds = bench_get_seconds() - start;
+
+    snprintf(name, sizeof(name), "build_diagram, %d x %d fan-in", process_count, fan_in);
+    bench_print_throughput(name, built ? seconds : 0.0, built ? element_count : 0);
+    bench_free_context(&context);
+  }
+
+  FreeArena(bench_arena);
+}
+
+
+
+
+int main(void) {
+  bench_process_allocation();
+
+  printf("bulk construction\n");
+  bench_bulk_construction(10000, 1);
+  bench_bulk_construction(1000000, 1);
+  bench_bulk_construction(1000000, 12);
+
+  printf("hover hit-testing\n");
+  bench_hover(1000);
+  bench_hover(10000);
+  bench_hover(100000);
+
+  printf("orientation\n");
+  bench_orientation();
+
+  printf("point-in-shape\n");
+  bench_point_in_shape(0);
+  bench_point_in_shape(1);
+
+  printf("side of curve\n");
+  bench_side_of_curve();
+
+  printf("curve tessellation\n");
+  bench_curve_tessellation();
+
+  printf("region queries\n");
+  bench_region_queries(100000, 200.0f);
+  bench_region_queries(100000, 2000.0f);
+
+  printf("frame time (input + draw-command generation)\n");
+  bench_frame_time(10000);
+  bench_frame_time(100000);
+  bench_command_batching(10000);
+  bench_command_batching(100000);
+
+  printf("render submission (hidden window)\n");
+  SetConfigFlags(FLAG_WINDOW_HIDDEN);
+  InitWindow(800, 500, "proc_bench");
+  // NOTE: load the rlgl batch, so both backends can be measured
+  render_LoadBackend(render_backend_Rlgl);
+  bench_render_submission(50000);
+  render_UnloadBackend();
+  CloseWindow();
+  return 0;
+}
@@ -1,5 +1,15 @@
 /*
     A wrapper for raylib rendering functions. Also, implements a command buffer, just in case we want to process the render-commands before actually drawing anything.
+
+    The command buffer is a stream of variable-size commands. Each one starts with a header holding its kind and its size, followed by only the payload that kind needs, and point arrays are sized to fit. render_Commands walks the stream by size. Sizes are rounded up to 8 bytes, so the pointers in payloads stay aligned.
+
+    Commands are not zeroed when pushed. Each push writes the fields its kind is drawn with, and nothing else is read.
+
+    Before drawing, render_Commands groups runs of adjacent commands that share a kind and a style into batches that are submitted together. Layers are drawn from 0 up, and the commands on a layer in the order they were pushed in, so painter's order holds within a layer. A layer whose commands can overlap in any order can be marked with render_SortLayerByKind, and then its commands are also grouped by kind, which makes for longer runs.
+
+    Commands that are pushed in that order already, layer by layer, are batched in a single pass over the stream. Only a stream that goes back to an earlier layer, or to an earlier kind on a sorted layer, is sorted first, by copying its commands into order.
+
+    Commands are drawn through raylib's shape functions by default. With render_LoadBackend(render_backend_Rlgl), batches of lines, rectangles and triangles skip raylib's shape functions. Their triangles are written straight into one large rlgl render batch, and that batch is flushed at the end of render_Commands, and whenever it fills up before that. The triangles are the same ones raylib would draw, with the same winding. Everything else, like text and circles, still goes through raylib, into the same render batch.
 */
 
 typedef enum
@@ -15,54 +25,213 @@ typedef enum
   render_command_DrawPolyLinesEx,
   render_command_DrawTriangleStrip,
   render_command_DrawTriangleFan,
+  render_command_DrawTriangleMesh,
+  render_command_DrawSplineLinear,
   render_command_DrawCircle,
   render_command_DrawCircleSector,
   render_command_DrawCircleLines,
   render_command_DrawCircleSectorLines,
+
+  render_command_Count,
 } render_command_kind;
 
 
-typedef struct render_command
+typedef struct render_command_header
 {
-  render_command_kind Kind;
+  U16 Kind;
+  U16 Layer;
+  // NOTE: The size of the whole command, header included.
+  U32 Size;
+} render_command_header;
+
+#define render_Command_Alignment 8
+#define render_Layer_Count 16
 
+
+// NOTE: ClearBackground
+typedef struct
+{
+  render_command_header Header;
+  Color Color;
+} render_command_color;
+
+// NOTE: DrawRectangleRec, DrawRectangle and DrawRectangleLinesEx
+typedef struct
+{
+  render_command_header Header;
   Rectangle Rectangle;
+  F32 Thickness;
+  Color Color;
+} render_command_rectangle;
+
+typedef struct
+{
+  render_command_header Header;
   const char *Text;
   F32 X;
   F32 Y;
+  S32 FontSize;
+  Color Color;
+} render_command_text;
+
+typedef struct
+{
+  render_command_header Header;
+  F32 X;
+  F32 Y;
   F32 X2;
   F32 Y2;
-  F32 ControlX;
-  F32 ControlY;
-  F32 ControlX2;
-  F32 ControlY2;
-  S32 FontSize;
   F32 Thickness;
-  F32 Rotation;
+  Color Color;
+} render_command_line;
+
+// NOTE: DrawPoly, DrawPolyLinesEx and every circle
+typedef struct
+{
+  render_command_header Header;
+  F32 X;
+  F32 Y;
   F32 Radius;
+  F32 Rotation;
+  F32 StartAngle;
+  F32 EndAngle;
+  F32 Thickness;
   S32 Sides;
   Color Color;
-  F32 Width;
-  F32 Height;
-#define render_Max_Points 32
-  Vector2 Points[render_Max_Points];
+} render_command_poly;
+
+// NOTE: DrawLineBezierCubic, DrawTriangleStrip and DrawTriangleFan, with the points copied in after the command.
+typedef struct
+{
+  render_command_header Header;
+  F32 Thickness;
   S32 PointCount;
-  F32 StartAngle;
-  F32 EndAngle;
-} render_command;
+  Color Color;
+  Vector2 Points[];
+} render_command_points;
+
+// NOTE: DrawSplineLinear, which has too many vertices to copy into the command.
+typedef struct
+{
+  render_command_header Header;
+  Vector2 *Vertices;
+  S32 VertexCount;
+  F32 Thickness;
+  Color Color;
+} render_command_vertices;
+
+// NOTE: DrawTriangleMesh, which points at the caller's points and triangles instead of copying them.
+typedef struct
+{
+  render_command_header Header;
+  Vector2 *Points;
+  U8 (*Triangles)[3];
+  S32 TriangleCount;
+  Color Color;
+} render_command_mesh;
+
+
+/*
+  A run of commands with the same kind, layer and style, drawn with one submission. They follow each other in memory, so they are walked from First with render_NextCommand.
+*/
+typedef struct render_batch
+{
+  render_command_header *First;
+  S32 CommandCount;
+} render_batch;
+
+#define render_NextCommand(Header) ((render_command_header *)((U8 *)(Header) + (Header)->Size))
+
+
+typedef enum
+{
+  render_backend_Raylib,
+  render_backend_Rlgl,
+} render_backend;
+
+// NOTE: In quads, so the batch holds four times as many vertices, 262144. A thick line segment is two triangles, six vertices, so that is about 43k segments. A frame with more than that flushes once each time the batch fills up.
+#define render_Rlgl_Batch_Elements (1 << 16)
 
 
 global_variable arena *GlobalTempArena;
+global_variable U32 GlobalRenderLayer;
+// NOTE: One bit per layer, set for the layers that render_SortLayerByKind was called on.
+global_variable U32 GlobalRenderSortedLayers;
+global_variable render_backend GlobalRenderBackend;
+global_variable rlRenderBatch GlobalRenderBatch;
 
 
 function void render_Initialize(arena *TempArena) {
   GlobalTempArena = TempArena;
 }
 
+/*
+  Pick the backend that render_Commands draws batches with. The rlgl backend loads its own render batch, which needs the graphics context, so call this after InitWindow, and unload it before CloseWindow.
+*/
+function void render_LoadBackend(render_backend Backend)
+{
+  if (Backend == render_backend_Rlgl)
+  {
+    GlobalRenderBatch = rlLoadRenderBatch(1, render_Rlgl_Batch_Elements);
+  }
+
+  GlobalRenderBackend = Backend;
+}
+
+function void render_UnloadBackend(void)
+{
+  if (GlobalRenderBackend == render_backend_Rlgl)
+  {
+    rlUnloadRenderBatch(GlobalRenderBatch);
+  }
+
+  GlobalRenderBackend = render_backend_Raylib;
+}
+
+/*
+  Every command pushed after this is drawn on Layer, until the layer is set again. Layers are drawn from 0 up.
+*/
+function void render_SetLayer(U32 Layer)
+{
+  Assert(Layer < render_Layer_Count);
+  GlobalRenderLayer = Layer;
+}
+
+/*
+  Let the commands on Layer be grouped by kind when they are drawn, instead of keeping the order they were pushed in. Only do this for layers where nothing has to be drawn over anything else.
+*/
+function void render_SortLayerByKind(U32 Layer)
+{
+  Assert(Layer < render_Layer_Count);
+  GlobalRenderSortedLayers |= 1u << Layer;
+}
+
+
+/*
+  Push a command of Size bytes, header included, and fill in its header. Returns zero if the arena is out of memory.
+*/
+function void *render_PushCommand(arena *Arena, render_command_kind Kind, U64 Size)
+{
+  U64 AlignedSize = (Size + (render_Command_Alignment-1)) & ~(U64)(render_Command_Alignment-1);
+  render_command_header *Header = (render_command_header *)ryn_memory_PushArray(Arena, U8, AlignedSize);
+
+  if (Header)
+  {
+    Header->Kind = (U16)Kind;
+    Header->Layer = (U16)GlobalRenderLayer;
+    Header->Size = (U32)AlignedSize;
+  }
+
+  return Header;
+}
+
+#define render_PushCommandStruct(Arena, Kind, type)\
+  ((type *)render_PushCommand((Arena), (Kind), sizeof(type)))
+
 
 function void render_ClearBackground(arena *Arena, Color C)
 {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_command_color *Command = render_PushCommandStruct(Arena, render_command_ClearBackground, render_command_color);
   if (Command)
   {
     Command->Color = C;
@@ -71,11 +240,10 @@ function void render_ClearBackground(arena *Arena, Color C)
 
 function void render_DrawRectangleRec(arena *Arena, Rectangle R, Color C)
 {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_command_rectangle *Command = render_PushCommandStruct(Arena, render_command_DrawRectangleRec, render_command_rectangle);
 
   if (Command)
   {
-    Command->Kind = render_command_DrawRectangleRec;
     Command->Rectangle = R;
     Command->Color = C;
   }
@@ -105,7 +273,7 @@ function char *render_PushTempString(const char *CString)
 
 function void render_DrawText(arena *Arena, const char *Text, F32 X, F32 Y, S32 FontSize, Color C, B32 copy_string)
 {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_command_text *Command = render_PushCommandStruct(Arena, render_command_DrawText, render_command_text);
   const char *RenderString;
   if (copy_string) {
     RenderString = render_PushTempString(Text);
@@ -115,7 +283,6 @@ function void render_DrawText(arena *Arena, const char *Text, F32 X, F32 Y, S32
 
   if (Command)
   {
-    Command->Kind = render_command_DrawText;
     Command->Text = RenderString;
     Command->X = X;
     Command->Y = Y;
@@ -126,11 +293,10 @@ function void render_DrawText(arena *Arena, const char *Text, F32 X, F32 Y, S32
 
 function void render_DrawRectangleLinesEx(arena *Arena, Rectangle R, F32 Thickness, Color C)
 {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_command_rectangle *Command = render_PushCommandStruct(Arena, render_command_DrawRectangleLinesEx, render_command_rectangle);
 
   if (Command)
   {
-    Command->Kind = render_command_DrawRectangleLinesEx;
     Command->Rectangle = R;
     Command->Thickness = Thickness;
     Command->Color = C;
@@ -139,26 +305,21 @@ function void render_DrawRectangleLinesEx(arena *Arena, Rectangle R, F32 Thickne
 
 function void render_DrawRectangle(arena *Arena, F32 X, F32 Y, F32 W, F32 H, Color C)
 {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_command_rectangle *Command = render_PushCommandStruct(Arena, render_command_DrawRectangle, render_command_rectangle);
 
   if (Command)
   {
-    Command->Kind = render_command_DrawRectangle;
-    Command->X = X;
-    Command->Y = Y;
-    Command->Width = W;
-    Command->Height = H;
+    Command->Rectangle = (Rectangle){X, Y, W, H};
     Command->Color = C;
   }
 }
 
 function void render_DrawLine(arena *Arena, int startPosX, int startPosY, int endPosX, int endPosY, F32 thickness, Color color)
 {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_command_line *Command = render_PushCommandStruct(Arena, render_command_DrawLine, render_command_line);
 
   if (Command)
   {
-    Command->Kind = render_command_DrawLine;
     Command->X = startPosX;
     Command->Y = startPosY;
     Command->X2 = endPosX;
@@ -169,30 +330,40 @@ function void render_DrawLine(arena *Arena, int startPosX, int startPosY, int en
 }
 
 
-function void render_DrawLineBezierCubic(arena *Arena, Vector2 startPos, Vector2 endPos, Vector2 startControlPos, Vector2 endControlPos, float thick, Color color)
+/*
+  Push a command with PointCount points copied in after it.
+*/
+function render_command_points *render_PushPointsCommand(arena *Arena, render_command_kind Kind, Vector2 *Points, S32 PointCount, F32 Thickness, Color Color)
 {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  U64 Size = sizeof(render_command_points) + PointCount*sizeof(Vector2);
+  render_command_points *Command = (render_command_points *)render_PushCommand(Arena, Kind, Size);
 
   if (Command)
   {
-    Command->Kind = render_command_DrawLineBezierCubic;
-    Command->Points[0] = startPos;
-    Command->Points[1] = startControlPos;
-    Command->Points[2] = endControlPos;
-    Command->Points[3] = endPos;
-    Command->PointCount = 4;
-    Command->Thickness = thick;
-    Command->Color = color;
+    Command->Thickness = Thickness;
+    Command->PointCount = PointCount;
+    Command->Color = Color;
+    for (S32 i = 0; i < PointCount; ++i) {
+      Command->Points[i] = Points[i];
+    }
   }
+
+  return Command;
+}
+
+
+function void render_DrawLineBezierCubic(arena *Arena, Vector2 startPos, Vector2 endPos, Vector2 startControlPos, Vector2 endControlPos, float thick, Color color)
+{
+  Vector2 Points[4] = {startPos, startControlPos, endControlPos, endPos};
+  render_PushPointsCommand(Arena, render_command_DrawLineBezierCubic, Points, 4, thick, color);
 }
 
 
 function void render_DrawPoly(arena *Arena, Vector2 center, int sides, float radius, float rotation, Color color) {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_command_poly *Command = render_PushCommandStruct(Arena, render_command_DrawPoly, render_command_poly);
 
   if (Command)
   {
-    Command->Kind = render_command_DrawPoly;
     Command->X = center.x;
     Command->Y = center.y;
     Command->Sides = sides;
@@ -203,11 +374,10 @@ function void render_DrawPoly(arena *Arena, Vector2 center, int sides, float rad
 }
 
 function void render_DrawPolyLinesEx(arena *Arena, Vector2 center, int sides, float radius, float rotation, float lineThick, Color color) {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_command_poly *Command = render_PushCommandStruct(Arena, render_command_DrawPolyLinesEx, render_command_poly);
 
   if (Command)
   {
-    Command->Kind = render_command_DrawPolyLinesEx;
     Command->X = center.x;
     Command->Y = center.y;
     Command->Sides = sides;
@@ -220,41 +390,52 @@ function void render_DrawPolyLinesEx(arena *Arena, Vector2 center, int sides, fl
 
 function void render_DrawTriangleStrip(arena *Arena, Vector2 *Points, S32 PointCount, Color Color)
 {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_PushPointsCommand(Arena, render_command_DrawTriangleStrip, Points, PointCount, 0.0f, Color);
+}
+
+function void render_DrawTriangleFan(arena *Arena, Vector2 *Points, int PointCount, Color Color)
+{
+  render_PushPointsCommand(Arena, render_command_DrawTriangleFan, Points, PointCount, 0.0f, Color);
+}
 
-  if (Command && PointCount <= render_Max_Points)
+/*
+  TriangleCount triangles, each one three indices into Points, drawn with a single command. Neither array is copied, so both have to stay alive until the commands are rendered.
+*/
+function void render_DrawTriangleMesh(arena *Arena, Vector2 *Points, U8 (*Triangles)[3], S32 TriangleCount, Color Color)
+{
+  render_command_mesh *Command = render_PushCommandStruct(Arena, render_command_DrawTriangleMesh, render_command_mesh);
+
+  if (Command)
   {
-    Command->Kind = render_command_DrawTriangleStrip;
-    for (S32 i = 0; i < PointCount; ++i) {
-      Command->Points[i] = Points[i];
-    }
-    Command->PointCount = PointCount;
+    Command->Points = Points;
+    Command->Triangles = Triangles;
+    Command->TriangleCount = TriangleCount;
     Command->Color = Color;
   }
 }
 
-function void render_DrawTriangleFan(arena *Arena, Vector2 *Points, int PointCount, Color Color)
+/*
+  A polyline of thick line segments. Like DrawTriangleMesh, Points is not copied.
+*/
+function void render_DrawSplineLinear(arena *Arena, Vector2 *Points, S32 PointCount, F32 Thickness, Color Color)
 {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_command_vertices *Command = render_PushCommandStruct(Arena, render_command_DrawSplineLinear, render_command_vertices);
 
-  if (Command && PointCount <= render_Max_Points)
+  if (Command)
   {
-    Command->Kind = render_command_DrawTriangleFan;
-    for (S32 i = 0; i < PointCount; ++i) {
-      Command->Points[i] = Points[i];
-    }
-    Command->PointCount = PointCount;
+    Command->Vertices = Points;
+    Command->VertexCount = PointCount;
+    Command->Thickness = Thickness;
     Command->Color = Color;
   }
 }
 
 function void render_DrawCircle(arena *Arena, Vector2 center, F32 radius, Color color)
 {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_command_poly *Command = render_PushCommandStruct(Arena, render_command_DrawCircle, render_command_poly);
 
   if (Command)
   {
-    Command->Kind = render_command_DrawCircle;
     Command->X = center.x;
     Command->Y = center.y;
     Command->Radius = radius;
@@ -264,11 +445,10 @@ function void render_DrawCircle(arena *Arena, Vector2 center, F32 radius, Color
 
 function void render_DrawCircleSector(arena *Arena, Vector2 center, float radius, float startAngle, float endAngle, Color color)
 {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_command_poly *Command = render_PushCommandStruct(Arena, render_command_DrawCircleSector, render_command_poly);
 
   if (Command)
   {
-    Command->Kind = render_command_DrawCircleSector;
     Command->X = center.x;
     Command->Y = center.y;
     Command->Radius = radius;
@@ -280,11 +460,10 @@ function void render_DrawCircleSector(arena *Arena, Vector2 center, float radius
 
 function void render_DrawCircleLines(arena *Arena, int centerX, int centerY, float radius, Color color)
 {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_command_poly *Command = render_PushCommandStruct(Arena, render_command_DrawCircleLines, render_command_poly);
 
   if (Command)
   {
-    Command->Kind = render_command_DrawCircleLines;
     Command->X = centerX;
     Command->Y = centerY;
     Command->Radius = radius;
@@ -294,11 +473,10 @@ function void render_DrawCircleLines(arena *Arena, int centerX, int centerY, flo
 
 function void render_DrawCircleSectorLines(arena *Arena, Vector2 center, float radius, float startAngle, float endAngle, Color color)
 {
-  render_command *Command = ryn_memory_PushZeroStruct(Arena, render_command);
+  render_command_poly *Command = render_PushCommandStruct(Arena, render_command_DrawCircleSectorLines, render_command_poly);
 
   if (Command)
   {
-    Command->Kind = render_command_DrawCircleSectorLines;
     Command->X = center.x;
     Command->Y = center.y;
     Command->Radius = radius;
@@ -310,35 +488,374 @@ function void render_DrawCircleSectorLines(arena *Arena, Vector2 center, float r
 
 
 
-function void render_Commands(arena *Arena)
+// NOTE: Commands on a layer that isn't sorted by kind all share the layer's first bucket, so they keep their order.
+#define render_Command_Bucket(Header) ((Header)->Layer*render_command_Count + ((GlobalRenderSortedLayers >> (Header)->Layer) & 1 ? (Header)->Kind : 0))
+
+function B32 render_ColorsAreEqual(Color A, Color B)
 {
-  // NOTE: Assume that the render commands get cleared every frame, so start from the start.
-  U32 CommandCount = Arena->Offset / sizeof(render_command);
-  render_command *Commands = (render_command *)Arena->Data;
+  B32 Result = A.r == B.r && A.g == B.g && A.b == B.b && A.a == B.a;
+  return Result;
+}
+
+/*
+  Two commands can share a batch when they have the same kind, layer and style. Clears, polygons and circles are never batched.
+*/
+function B32 render_CanBatchCommands(render_command_header *A, render_command_header *B)
+{
+  B32 Result = 0;
+
+  if (A->Kind == B->Kind && A->Layer == B->Layer)
+  {
+    render_command_rectangle *RectA = (render_command_rectangle *)A;
+    render_command_rectangle *RectB = (render_command_rectangle *)B;
+    render_command_text *TextA = (render_command_text *)A;
+    render_command_text *TextB = (render_command_text *)B;
+    render_command_line *LineA = (render_command_line *)A;
+    render_command_line *LineB = (render_command_line *)B;
+    render_command_points *PointsA = (render_command_points *)A;
+    render_command_points *PointsB = (render_command_points *)B;
+    render_command_vertices *VerticesA = (render_command_vertices *)A;
+    render_command_vertices *VerticesB = (render_command_vertices *)B;
+    render_command_mesh *MeshA = (render_command_mesh *)A;
+    render_command_mesh *MeshB = (render_command_mesh *)B;
+
+    switch(A->Kind)
+    {
+    case render_command_DrawRectangleRec:
+    case render_command_DrawRectangle: { Result = render_ColorsAreEqual(RectA->Color, RectB->Color); } break;
+    case render_command_DrawRectangleLinesEx: { Result = RectA->Thickness == RectB->Thickness && render_ColorsAreEqual(RectA->Color, RectB->Color); } break;
+    case render_command_DrawText: { Result = TextA->FontSize == TextB->FontSize && render_ColorsAreEqual(TextA->Color, TextB->Color); } break;
+    case render_command_DrawLine: { Result = LineA->Thickness == LineB->Thickness && render_ColorsAreEqual(LineA->Color, LineB->Color); } break;
+    case render_command_DrawLineBezierCubic: { Result = PointsA->Thickness == PointsB->Thickness && render_ColorsAreEqual(PointsA->Color, PointsB->Color); } break;
+    case render_command_DrawTriangleStrip:
+    case render_command_DrawTriangleFan: { Result = render_ColorsAreEqual(PointsA->Color, PointsB->Color); } break;
+    case render_command_DrawTriangleMesh: { Result = render_ColorsAreEqual(MeshA->Color, MeshB->Color); } break;
+    case render_command_DrawSplineLinear: { Result = VerticesA->Thickness == VerticesB->Thickness && render_ColorsAreEqual(VerticesA->Color, VerticesB->Color); } break;
+    }
+  }
+
+  return Result;
+}
+
+/*
+  Split the commands from Start to End into batches, pushed onto TempArena. Returns 0 as soon as a command belongs in an earlier bucket than the one before it, since the commands then have to be sorted first. BatchCount is zero if TempArena runs out of memory.
+*/
+function B32 render_GroupCommands(U8 *Start, U8 *End, arena *TempArena, render_batch **Batches, S32 *BatchCount)
+{
+  B32 InOrder = 1;
+  U32 LastBucket = 0;
+  S32 Count = 0;
+  render_batch *Batch = 0;
+
+  *Batches = 0;
+
+  for (U8 *At = Start; At < End && InOrder; At += ((render_command_header *)At)->Size)
+  {
+    render_command_header *Header = (render_command_header *)At;
+    U32 Bucket = render_Command_Bucket(Header);
+    InOrder = Bucket >= LastBucket;
+    LastBucket = Bucket;
+
+    if (InOrder && (Count == 0 || !render_CanBatchCommands(Batch->First, Header)))
+    {
+      // NOTE: Consecutive batches are pushed back to back, so they form one array.
+      Batch = ryn_memory_PushAlignedStruct(TempArena, render_batch);
+      if (Batch)
+      {
+        Batch->First = Header;
+        Batch->CommandCount = 0;
+        *Batches = Count ? *Batches : Batch;
+        Count += 1;
+      }
+      else
+      {
+        Count = 0;
+        break;
+      }
+    }
+
+    if (InOrder)
+    {
+      Batch->CommandCount += 1;
+    }
+  }
+
+  *BatchCount = InOrder ? Count : 0;
+  return InOrder;
+}
+
+/*
+  Copy the commands from Start to End onto TempArena, sorted by layer, and by kind on the layers marked with render_SortLayerByKind. The sort is a counting sort over (layer, kind) buckets, so it is stable. Returns the start of the copy, or zero if TempArena is out of memory.
+*/
+function U8 *render_SortCommands(U8 *Start, U8 *End, arena *TempArena)
+{
+  U64 Buckets[render_Layer_Count*render_command_Count] = {0};
 
-  for (U32 i = 0; i < CommandCount; ++i)
+  for (U8 *At = Start; At < End; At += ((render_command_header *)At)->Size)
   {
-    render_command *C = Commands + i;
+    render_command_header *Header = (render_command_header *)At;
+    Buckets[render_Command_Bucket(Header)] += Header->Size;
+  }
+
+  // NOTE: Turn the bucket sizes into the offset of each bucket's first command.
+  U64 BucketStart = 0;
+  for (S32 i = 0; i < render_Layer_Count*render_command_Count; ++i)
+  {
+    U64 BucketSize = Buckets[i];
+    Buckets[i] = BucketStart;
+    BucketStart += BucketSize;
+  }
 
-    switch(C->Kind)
+  U8 *Sorted = (U8 *)ryn_memory_PushAlignedArray(TempArena, U64, (End - Start)/sizeof(U64));
+
+  if (Sorted)
+  {
+    for (U8 *At = Start; At < End; At += ((render_command_header *)At)->Size)
     {
-    case render_command_ClearBackground: { ClearBackground(C->Color); } break;
-    case render_command_DrawRectangleRec: { DrawRectangleRec(C->Rectangle, C->Color); } break;
-    case render_command_DrawText: { DrawText(C->Text, C->X, C->Y, C->FontSize, C->Color); } break;
-    case render_command_DrawRectangleLinesEx: { DrawRectangleLinesEx(C->Rectangle, C->Thickness, C->Color); } break;
-    case render_command_DrawRectangle: { DrawRectangle(C->X, C->Y, C->Width, C->Height, C->Color); } break;
-    case render_command_DrawLine: { DrawLineEx((Vector2){C->X, C->Y}, (Vector2){C->X2, C->Y2}, C->Thickness, C->Color); } break;
-    case render_command_DrawLineBezierCubic: { DrawSplineBezierCubic(C->Points, C->PointCount, C->Thickness, C->Color); } break;
-    case render_command_DrawPoly: { DrawPoly((Vector2){C->X, C->Y}, C->Sides, C->Radius, C->Rotation, C->Color); } break;
-    case render_command_DrawPolyLinesEx: { DrawPolyLinesEx((Vector2){C->X, C->Y}, C->Sides, C->Radius, C->Rotation, C->Thickness, C->Color); } break;
-    case render_command_DrawTriangleStrip: { DrawTriangleStrip(C->Points, C->PointCount, C->Color); } break;
-    case render_command_DrawTriangleFan: { DrawTriangleFan(C->Points, C->PointCount, C->Color); } break;
-    case render_command_DrawCircle: { DrawCircle(C->X, C->Y, C->Radius, C->Color); } break;
-    case render_command_DrawCircleSector: { DrawCircleSector((Vector2){C->X, C->Y}, C->Radius, C->StartAngle, C->EndAngle, 10, C->Color); } break;
-    case render_command_DrawCircleLines: { DrawCircleLines(C->X, C->Y, C->Radius, C->Color); } break;
-    case render_command_DrawCircleSectorLines: { DrawCircleSectorLines((Vector2){C->X, C->Y}, C->Radius, C->StartAngle, C->EndAngle, 10, C->Color); } break;
-
-    default: Assert(0); break;
+      render_command_header *Header = (render_command_header *)At;
+      U64 *Offset = &Buckets[render_Command_Bucket(Header)];
+      CopyMemory((U8 *)Header, Sorted + *Offset, Header->Size);
+      *Offset += Header->Size;
     }
   }
+
+  return Sorted;
+}
+
+/*
+  Split the commands in Arena into batches, sorting them first if they weren't pushed in order. The batches, and the sorted copy of the commands if there is one, are pushed onto TempArena, so they are valid until the caller pops it. BatchCount is zero if TempArena is out of memory.
+*/
+function render_batch *render_BatchCommands(arena *Arena, arena *TempArena, S32 *BatchCount)
+{
+  U8 *Start = Arena->Data;
+  U8 *End = Arena->Data + Arena->Offset;
+  U64 TempOffset = TempArena->Offset;
+  render_batch *Batches = 0;
+
+  if (!render_GroupCommands(Start, End, TempArena, &Batches, BatchCount))
+  {
+    TempArena->Offset = TempOffset;
+    U8 *Sorted = render_SortCommands(Start, End, TempArena);
+
+    if (Sorted)
+    {
+      render_GroupCommands(Sorted, Sorted + (End - Start), TempArena, &Batches, BatchCount);
+    }
+  }
+
+  return Batches;
+}
+
+
+#define render_RlglColor(C) rlColor4ub((C).r, (C).g, (C).b, (C).a)
+#define render_RlglVertex(V) rlVertex2f((V).x, (V).y)
+
+function B32 render_IsRlglKind(U32 Kind)
+{
+  B32 Result = 0;
+
+  switch(Kind)
+  {
+  case render_command_DrawRectangleRec:
+  case render_command_DrawRectangle:
+  case render_command_DrawLine:
+  case render_command_DrawTriangleStrip:
+  case render_command_DrawTriangleFan:
+  case render_command_DrawTriangleMesh:
+  case render_command_DrawSplineLinear: { Result = 1; } break;
+  }
+
+  return Result;
+}
+
+/*
+  The two triangles of DrawLineEx.
+*/
+function void render_RlglLine(Vector2 Start, Vector2 End, F32 Thickness)
+{
+  Vector2 Delta = (Vector2){End.x - Start.x, End.y - Start.y};
+  F32 Length = sqrtf(Delta.x*Delta.x + Delta.y*Delta.y);
+
+  if (Length > 0.0f && Thickness > 0.0f)
+  {
+    F32 Scale = Thickness/(2.0f*Length);
+    Vector2 Radius = (Vector2){-Scale*Delta.y, Scale*Delta.x};
+    Vector2 S0 = (Vector2){Start.x - Radius.x, Start.y - Radius.y};
+    Vector2 S1 = (Vector2){Start.x + Radius.x, Start.y + Radius.y};
+    Vector2 S2 = (Vector2){End.x - Radius.x, End.y - Radius.y};
+    Vector2 S3 = (Vector2){End.x + Radius.x, End.y + Radius.y};
+
+    render_RlglVertex(S2); render_RlglVertex(S0); render_RlglVertex(S1);
+    render_RlglVertex(S3); render_RlglVertex(S2); render_RlglVertex(S1);
+  }
+}
+
+/*
+  The two triangles of DrawRectangleRec.
+*/
+function void render_RlglRectangle(Rectangle R)
+{
+  Vector2 TopLeft = (Vector2){R.x, R.y};
+  Vector2 TopRight = (Vector2){R.x + R.width, R.y};
+  Vector2 BottomLeft = (Vector2){R.x, R.y + R.height};
+  Vector2 BottomRight = (Vector2){R.x + R.width, R.y + R.height};
+
+  render_RlglVertex(TopLeft); render_RlglVertex(BottomLeft); render_RlglVertex(TopRight);
+  render_RlglVertex(TopRight); render_RlglVertex(BottomLeft); render_RlglVertex(BottomRight);
+}
+
+function void render_RlglTriangleMesh(render_command_mesh *Mesh)
+{
+  render_RlglColor(Mesh->Color);
+  for (S32 t = 0; t < Mesh->TriangleCount; ++t) {
+    U8 *Triangle = Mesh->Triangles[t];
+    render_RlglVertex(Mesh->Points[Triangle[0]]); render_RlglVertex(Mesh->Points[Triangle[1]]); render_RlglVertex(Mesh->Points[Triangle[2]]);
+  }
+}
+
+function void render_Command(render_command_header *Header)
+{
+  render_command_color *Color = (render_command_color *)Header;
+  render_command_rectangle *Rect = (render_command_rectangle *)Header;
+  render_command_text *Text = (render_command_text *)Header;
+  render_command_line *Line = (render_command_line *)Header;
+  render_command_poly *Poly = (render_command_poly *)Header;
+  render_command_points *Points = (render_command_points *)Header;
+  render_command_vertices *Vertices = (render_command_vertices *)Header;
+  render_command_mesh *Mesh = (render_command_mesh *)Header;
+
+  switch(Header->Kind)
+  {
+  case render_command_ClearBackground: { ClearBackground(Color->Color); } break;
+  case render_command_DrawRectangleRec: { DrawRectangleRec(Rect->Rectangle, Rect->Color); } break;
+  case render_command_DrawText: { DrawText(Text->Text, Text->X, Text->Y, Text->FontSize, Text->Color); } break;
+  case render_command_DrawRectangleLinesEx: { DrawRectangleLinesEx(Rect->Rectangle, Rect->Thickness, Rect->Color); } break;
+  case render_command_DrawRectangle: { DrawRectangle(Rect->Rectangle.x, Rect->Rectangle.y, Rect->Rectangle.width, Rect->Rectangle.height, Rect->Color); } break;
+  case render_command_DrawLine: { DrawLineEx((Vector2){Line->X, Line->Y}, (Vector2){Line->X2, Line->Y2}, Line->Thickness, Line->Color); } break;
+  case render_command_DrawLineBezierCubic: { DrawSplineBezierCubic(Points->Points, Points->PointCount, Points->Thickness, Points->Color); } break;
+  case render_command_DrawPoly: { DrawPoly((Vector2){Poly->X, Poly->Y}, Poly->Sides, Poly->Radius, Poly->Rotation, Poly->Color); } break;
+  case render_command_DrawPolyLinesEx: { DrawPolyLinesEx((Vector2){Poly->X, Poly->Y}, Poly->Sides, Poly->Radius, Poly->Rotation, Poly->Thickness, Poly->Color); } break;
+  case render_command_DrawTriangleStrip: { DrawTriangleStrip(Points->Points, Points->PointCount, Points->Color); } break;
+  case render_command_DrawTriangleFan: { DrawTriangleFan(Points->Points, Points->PointCount, Points->Color); } break;
+  case render_command_DrawTriangleMesh: {
+    // NOTE: raylib has no call for a list of triangles, so write them through rlgl like raylib's own shapes do, rather than with a DrawTriangle per triangle.
+    rlBegin(RL_TRIANGLES);
+    render_RlglTriangleMesh(Mesh);
+    rlEnd();
+  } break;
+  case render_command_DrawSplineLinear: { DrawSplineLinear(Vertices->Vertices, Vertices->VertexCount, Vertices->Thickness, Vertices->Color); } break;
+  case render_command_DrawCircle: { DrawCircle(Poly->X, Poly->Y, Poly->Radius, Poly->Color); } break;
+  case render_command_DrawCircleSector: { DrawCircleSector((Vector2){Poly->X, Poly->Y}, Poly->Radius, Poly->StartAngle, Poly->EndAngle, 10, Poly->Color); } break;
+  case render_command_DrawCircleLines: { DrawCircleLines(Poly->X, Poly->Y, Poly->Radius, Poly->Color); } break;
+  case render_command_DrawCircleSectorLines: { DrawCircleSectorLines((Vector2){Poly->X, Poly->Y}, Poly->Radius, Poly->StartAngle, Poly->EndAngle, 10, Poly->Color); } break;
+
+  default: Assert(0); break;
+  }
+}
+
+/*
+  Write a whole batch as triangles into the active render batch, between a single rlBegin and rlEnd. rlgl flushes by itself if the batch fills up, but only between triangles.
+*/
+function void render_DrawBatchRlgl(render_batch Batch)
+{
+  rlBegin(RL_TRIANGLES);
+
+  render_command_header *Header = Batch.First;
+
+  for (S32 i = 0; i < Batch.CommandCount; ++i, Header = render_NextCommand(Header))
+  {
+    render_command_rectangle *Rect = (render_command_rectangle *)Header;
+    render_command_line *Line = (render_command_line *)Header;
+    render_command_points *Points = (render_command_points *)Header;
+    render_command_vertices *Vertices = (render_command_vertices *)Header;
+    render_command_mesh *Mesh = (render_command_mesh *)Header;
+
+    switch(Header->Kind)
+    {
+    case render_command_DrawRectangleRec:
+    case render_command_DrawRectangle: {
+      render_RlglColor(Rect->Color);
+      render_RlglRectangle(Rect->Rectangle);
+    } break;
+    case render_command_DrawLine: {
+      render_RlglColor(Line->Color);
+      render_RlglLine((Vector2){Line->X, Line->Y}, (Vector2){Line->X2, Line->Y2}, Line->Thickness);
+    } break;
+    case render_command_DrawTriangleStrip: {
+      render_RlglColor(Points->Color);
+      for (S32 v = 2; v < Points->PointCount; ++v) {
+        if (v % 2 == 0) {
+          render_RlglVertex(Points->Points[v]); render_RlglVertex(Points->Points[v-2]); render_RlglVertex(Points->Points[v-1]);
+        } else {
+          render_RlglVertex(Points->Points[v]); render_RlglVertex(Points->Points[v-1]); render_RlglVertex(Points->Points[v-2]);
+        }
+      }
+    } break;
+    case render_command_DrawTriangleFan: {
+      render_RlglColor(Points->Color);
+      for (S32 v = 1; v + 1 < Points->PointCount; ++v) {
+        render_RlglVertex(Points->Points[0]); render_RlglVertex(Points->Points[v]); render_RlglVertex(Points->Points[v+1]);
+      }
+    } break;
+    case render_command_DrawTriangleMesh: {
+      render_RlglTriangleMesh(Mesh);
+    } break;
+    case render_command_DrawSplineLinear: {
+      // NOTE: Like DrawSplineLinear, which draws every segment as its own line, without joins.
+      render_RlglColor(Vertices->Color);
+      for (S32 v = 0; v + 1 < Vertices->VertexCount; ++v) {
+        render_RlglLine(Vertices->Vertices[v], Vertices->Vertices[v+1], Vertices->Thickness);
+      }
+    } break;
+    }
+  }
+
+  rlEnd();
+}
+
+/*
+  raylib merges consecutive draws that use the same primitive mode and texture into one draw call, so the commands of a batch are drawn back to back without anything in between that would break that up.
+*/
+function void render_DrawBatch(render_batch Batch)
+{
+  if (GlobalRenderBackend == render_backend_Rlgl && render_IsRlglKind(Batch.First->Kind))
+  {
+    render_DrawBatchRlgl(Batch);
+  }
+  else
+  {
+    render_command_header *Header = Batch.First;
+
+    for (S32 i = 0; i < Batch.CommandCount; ++i, Header = render_NextCommand(Header))
+    {
+      render_Command(Header);
+    }
+  }
+}
+
+function void render_Commands(arena *Arena)
+{
+  // NOTE: Assume that the render commands get cleared every frame, so start from the start.
+  ryn_memory_BeginArena(GlobalTempArena);
+
+  // NOTE: Switching render batches flushes the one that was active, so this draws whatever raylib had queued before, and switching back flushes every command below at once.
+  if (GlobalRenderBackend == render_backend_Rlgl)
+  {
+    rlSetRenderBatchActive(&GlobalRenderBatch);
+  }
+
+  S32 BatchCount = 0;
+  render_batch *Batches = render_BatchCommands(Arena, GlobalTempArena, &BatchCount);
+
+  for (S32 i = 0; i < BatchCount; ++i)
+  {
+    render_DrawBatch(Batches[i]);
+  }
+
+  if (GlobalRenderBackend == render_backend_Rlgl)
+  {
+    rlSetRenderBatchActive(0);
+  }
+
+  ryn_memory_EndArena(GlobalTempArena);
 }